@@ -0,0 +1,169 @@
+#include "ds18b20_sim.h"
+#include "ds2431_sim.h"
+#include "ow_pio_emu.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define API_BENCH_DEVICES   8       /**< Devices on the bus for the per-device calls. */
+#define API_BENCH_CALLS     50      /**< Calls per measurement on the simulated backend. */
+
+/**
+ * @brief Bus under test: simulated devices behind either backend.
+ */
+typedef struct {
+    OW ow;
+    ow_sim_bus bus;
+    ow_pio_emu emu;
+    ds18b20_sim *sensors;
+    ds2431_sim *eeproms;
+    int num_devices;
+    uint64_t *romcodes;
+} bench_bus;
+
+typedef void (*bench_call)(bench_bus *b);
+
+static const ow_pio_program *pio_program;  /**< Emulated program, or NULL for the simulated backend. */
+static bool first_result = true;
+
+/**
+ * @brief Make a random ROM code with a valid CRC.
+ */
+static uint64_t make_romcode(uint8_t family) {
+    uint8_t rom[8] = {family};
+    for (int i = 1; i < 7; i++) {
+        rom[i] = (uint8_t)rand();
+    }
+    rom[7] = ow_crc_8(rom, 7);
+    uint64_t romcode = 0;
+    for (int i = 0; i < 8; i++) {
+        romcode |= (uint64_t)rom[i] << (8*i);
+    }
+    return romcode;
+}
+
+/**
+ * @brief Populate a bus with alternating DS18B20 and DS2431 models.
+ */
+static void bench_bus_init(bench_bus *b, int num_devices) {
+    memset(b, 0, sizeof(*b));
+    ow_sim_bus_init(&b->bus);
+    b->sensors = calloc(num_devices, sizeof(*b->sensors));
+    b->eeproms = calloc(num_devices, sizeof(*b->eeproms));
+    b->romcodes = calloc(num_devices, sizeof(*b->romcodes));
+    b->num_devices = num_devices;
+    for (int i = 0; i < num_devices; i++) {
+        if (i % 2 == 0) {
+            ds18b20_sim_init(&b->sensors[i], make_romcode(DS18B20_FAMILY), (int16_t)(20 * 16 + i));
+            ow_sim_attach(&b->bus, &b->sensors[i].dev);
+            b->romcodes[i] = b->sensors[i].dev.romcode;
+        } else {
+            ds2431_sim_init(&b->eeproms[i], make_romcode(DS2431_FAMILY));
+            ow_sim_attach(&b->bus, &b->eeproms[i].dev);
+            b->romcodes[i] = b->eeproms[i].dev.romcode;
+        }
+    }
+    if (pio_program != NULL) {
+        ow_pio_emu_init(&b->emu, pio_program, &b->bus);
+        ow_pio_emu_attach(&b->ow, &b->emu);
+    } else {
+        ow_sim_init(&b->ow, &b->bus);
+    }
+}
+
+static void bench_bus_free(bench_bus *b) {
+    ow_sim_bus_free(&b->bus);
+    free(b->sensors);
+    free(b->eeproms);
+    free(b->romcodes);
+}
+
+/**
+ * @brief Time a call and print one JSON result with the bus time, FIFO words and CPU cycles per call.
+ */
+static void measure(bench_bus *b, const char *api, int bytes, int calls, bench_call call) {
+    uint64_t bus_us = ow_time_us(&b->ow);
+    uint64_t fifo_ops = b->bus.fifo_ops;
+    uint64_t cycles = bench_cycles();
+    for (int i = 0; i < calls; i++) {
+        call(b);
+    }
+    cycles = bench_cycles() - cycles;
+    bus_us = ow_time_us(&b->ow) - bus_us;
+    fifo_ops = b->bus.fifo_ops - fifo_ops;
+
+    printf("%s\n    {\"api\": \"%s\", \"devices\": %d, \"bytes\": %d, \"calls\": %d, "
+           "\"bus_us\": %.1f, \"fifo_ops\": %.1f, \"cycles\": %.0f}",
+           first_result ? "" : ",", api, b->num_devices, bytes, calls,
+           (double)bus_us / calls, (double)fifo_ops / calls, (double)cycles / calls);
+    first_result = false;
+}
+
+static void call_reset(bench_bus *b) {
+    ow_reset(&b->ow);
+}
+
+static void call_select(bench_bus *b) {
+    b->ow.resume = false;                   // Measure MATCH ROM rather than RESUME.
+    ow_select(&b->ow, &b->romcodes[1]);
+}
+
+static void call_select_resume(bench_bus *b) {
+    ow_select(&b->ow, &b->romcodes[1]);     // Re-selects the device matched by the previous call.
+}
+
+static void call_romsearch(bench_bus *b) {
+    ow_romsearch(&b->ow, b->romcodes, b->num_devices, OW_SEARCH_ROM);
+}
+
+static void call_read_temperature(bench_bus *b) {
+    ds18b20_read_temperature(&b->ow, &b->romcodes[0]);
+}
+
+static void call_ds2431_read(bench_bus *b) {
+    uint8_t buffer[DS2431_SIZE];
+    ds2431_read(&b->ow, &b->romcodes[1], DS2431_START, buffer, sizeof(buffer));
+}
+
+static void call_ds2431_write(bench_bus *b) {
+    static uint8_t count;
+    uint8_t row[DS2431_ROW_SIZE] = {count++, 2, 3, 4, 5, 6, 7, 8};  // Changed every call, so the row is programmed.
+    ds2431_write(&b->ow, &b->romcodes[1], DS2431_START, row, sizeof(row));
+}
+
+int main(int argc, char **argv) {
+    // The emulated backend runs onewire.pio cycle by cycle, so it is measured with fewer calls.
+    static ow_pio_program program;
+    bool pio = argc > 1 && strcmp(argv[1], "pio") == 0;
+    int calls = API_BENCH_CALLS;
+    if (pio) {
+        if (!ow_pio_assemble(&program, argc > 2 ? argv[2] : OW_PIO_SOURCE)) {
+            fprintf(stderr, "cannot assemble onewire.pio\n");
+            return 1;
+        }
+        pio_program = &program;
+        calls = API_BENCH_CALLS / 10;
+    }
+
+    printf("{\n  \"backend\": \"%s\",\n  \"results\": [", pio ? "pio" : "sim");
+    bench_bus b;
+    bench_bus_init(&b, API_BENCH_DEVICES);
+    measure(&b, "ow_reset", 0, calls, call_reset);
+    measure(&b, "ow_select", 9, calls, call_select);
+    measure(&b, "ow_select_resume", 1, calls, call_select_resume);
+    measure(&b, "ds18b20_read_temperature", 2, calls, call_read_temperature);
+    measure(&b, "ds2431_read", DS2431_SIZE, calls, call_ds2431_read);
+    measure(&b, "ds2431_write", DS2431_ROW_SIZE, calls, call_ds2431_write);
+    bench_bus_free(&b);
+
+    // Search time as a function of the number of devices.
+    static const int device_counts[] = {1, 10, 100, 1000};
+    for (size_t i = 0; i < sizeof(device_counts)/sizeof(device_counts[0]); i++) {
+        bench_bus_init(&b, device_counts[i]);
+        measure(&b, "ow_romsearch", 0, 1, call_romsearch);
+        bench_bus_free(&b);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
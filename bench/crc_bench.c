@@ -0,0 +1,63 @@
+#include "ow_crc.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if OW_CRC_SIMD
+#define ENGINE_NAME "clmul"
+#elif OW_CRC_ENGINE == OW_CRC_BITWISE
+#define ENGINE_NAME "bitwise"
+#elif OW_CRC_ENGINE == OW_CRC_NIBBLE
+#define ENGINE_NAME "nibble"
+#elif OW_CRC_ENGINE == OW_CRC_TABLE
+#define ENGINE_NAME "table"
+#else
+#define ENGINE_NAME "slice4"
+#endif
+
+#define BENCH_BYTES (1u << 24)  /**< Bytes processed per measurement. */
+
+int main(void) {
+    // Buffer lengths: ROM code, DS2431 scratchpad read, whole DS2431 memory, bulk.
+    static const size_t lengths[] = {8, 13, 128, 4096, 65536};
+    static uint8_t buffer[65536];
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (uint8_t)rand();
+    }
+
+    printf("engine   tables(B)  length  crc8(cyc/B)  crc8(ns/B)  crc16(cyc/B)  crc16(ns/B)\n");
+    volatile unsigned sink = 0;    // Keep the results live.
+    for (size_t l = 0; l < sizeof(lengths)/sizeof(lengths[0]); l++) {
+        size_t len = lengths[l];
+        size_t iterations = BENCH_BYTES / len;
+
+        // Check the buffer functions against the byte-wise update.
+        uint8_t crc_8 = CRC_START_8;
+        uint16_t crc_16 = CRC_START_16;
+        for (size_t i = 0; i < len; i++) {
+            crc_8 = ow_update_crc_8(crc_8, buffer[i]);
+            crc_16 = ow_update_crc_16(crc_16, buffer[i]);
+        }
+        if (crc_8 != ow_crc_8(buffer, len) || crc_16 != ow_crc_16(buffer, len)) {
+            printf("%s: CRC mismatch for length %zu\n", ENGINE_NAME, len);
+            return 1;
+        }
+
+        uint64_t c0 = bench_cycles(), t0 = bench_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            sink += ow_crc_8(buffer, len);
+            buffer[0] = (uint8_t)sink;      // Defeat hoisting out of the loop.
+        }
+        uint64_t c1 = bench_cycles(), t1 = bench_ns();
+        for (size_t i = 0; i < iterations; i++) {
+            sink += ow_crc_16(buffer, len);
+            buffer[0] = (uint8_t)sink;
+        }
+        uint64_t c2 = bench_cycles(), t2 = bench_ns();
+
+        double bytes = (double)(iterations * len);
+        printf("%-8s %9d  %6zu  %11.2f  %10.3f  %12.2f  %11.3f\n", ENGINE_NAME, OW_CRC_TABLE_BYTES, len,
+               (c1 - c0) / bytes, (t1 - t0) / bytes, (c2 - c1) / bytes, (t2 - t1) / bytes);
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "ow_pio_emu.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TIMING_DEVICES  8   /**< Devices on the emulated bus. */
+
+/**
+ * @brief Make a random ROM code with a valid CRC.
+ */
+static uint64_t make_romcode(uint8_t family) {
+    uint8_t rom[8] = {family};
+    for (int i = 1; i < 7; i++) {
+        rom[i] = (uint8_t)rand();
+    }
+    rom[7] = ow_crc_8(rom, 7);
+    uint64_t romcode = 0;
+    for (int i = 0; i < 8; i++) {
+        romcode |= (uint64_t)rom[i] << (8*i);
+    }
+    return romcode;
+}
+
+/**
+ * @brief Bus occupancy counters at the start of a call.
+ */
+typedef struct {
+    uint64_t ns;
+    uint64_t busy;
+    uint64_t low;
+    uint64_t fifo_ops;
+} occupancy;
+
+static occupancy start(const ow_pio_emu *emu) {
+    occupancy o = {ow_pio_emu_time_ns(emu), emu->busy_cycles, emu->low_ns, emu->bus->fifo_ops};
+    return o;
+}
+
+/**
+ * @brief Run the state machine until it stalls waiting for data, so that a call is charged with its whole waveform
+ * (e.g. the end of the presence detect window after a reset result has been returned).
+ */
+static void drain(ow_pio_emu *emu) {
+    do {
+        ow_pio_emu_step(emu);
+    } while (!(emu->stalled && emu->tx_len == 0 && !emu->line_low));
+}
+
+/**
+ * @brief Number of ROM codes found without a CRC error.
+ */
+static int search(OW *ow, uint64_t *romcodes) {
+    uint8_t status[TIMING_DEVICES];
+    int num_found = ow_romsearch_status(ow, romcodes, status, TIMING_DEVICES, OW_SEARCH_ROM);
+    int valid = 0;
+    for (int i = 0; i < num_found; i++) {
+        valid += status[i] != OW_ROM_CRC_ERROR;
+    }
+    return valid;
+}
+
+static void report(const char *name, ow_pio_emu *emu, occupancy o) {
+    drain(emu);
+    printf("%-16s %10.1f %10llu %10.1f %9llu\n", name,
+           (ow_pio_emu_time_ns(emu) - o.ns) / 1000.0,
+           (unsigned long long)(emu->busy_cycles - o.busy),
+           (emu->low_ns - o.low) / 1000.0,
+           (unsigned long long)(emu->bus->fifo_ops - o.fifo_ops));
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : OW_PIO_SOURCE;
+    ow_pio_program program;
+    if (!ow_pio_assemble(&program, path)) {
+        fprintf(stderr, "cannot assemble %s\n", path);
+        return 1;
+    }
+    printf("%s: %u instructions, wrap %u..%u, reset_bus %d, fetch_bit %d\n", path, program.length,
+           program.wrap_target, program.wrap, program.offset_reset_bus, program.offset_fetch_bit);
+
+    ow_sim_bus bus;
+    ow_sim_bus_init(&bus);
+    static ow_sim_device devices[TIMING_DEVICES];
+    uint64_t romcodes[TIMING_DEVICES];
+    for (int i = 0; i < TIMING_DEVICES; i++) {
+        romcodes[i] = make_romcode(0x28);
+        ow_sim_device_init(&devices[i], romcodes[i], NULL);
+        ow_sim_attach(&bus, &devices[i]);
+    }
+
+    ow_pio_emu emu;
+    ow_pio_emu_init(&emu, &program, &bus);
+    OW ow;
+    ow_pio_emu_attach(&ow, &emu);
+
+    // Waveform timing of a reset and of read and write slots.
+    bool present = ow_reset(&ow);
+    printf("reset: present %d, low %.1f us\n", present, emu.last_reset_low_ns / 1000.0);
+    ow_send(&ow, 0x00);
+    printf("write slot: period %.1f us\n", emu.last_slot_ns / 1000.0);
+    ow_read(&ow);
+    printf("read slot: period %.1f us, master sample %.1f us after the falling edge\n",
+           emu.last_slot_ns / 1000.0, emu.last_sample_ns / 1000.0);
+
+    drain(&emu);
+
+    // Bus occupancy per call: elapsed time, state machine busy cycles, time held low and FIFO words.
+    printf("\n%-16s %10s %10s %10s %9s\n", "call", "bus(us)", "busy(cyc)", "low(us)", "fifo_ops");
+    occupancy o = start(&emu);
+    ow_reset(&ow);
+    report("ow_reset", &emu, o);
+    o = start(&emu);
+    ow_send(&ow, OW_SKIP_ROM);
+    report("ow_send", &emu, o);
+    o = start(&emu);
+    ow_read(&ow);
+    report("ow_read", &emu, o);
+    o = start(&emu);
+    ow_select(&ow, &romcodes[0]);
+    report("ow_select", &emu, o);
+    o = start(&emu);
+    bool verified = ow_verify(&ow, romcodes[1]);
+    report("ow_verify", &emu, o);
+    uint64_t found[TIMING_DEVICES];
+    o = start(&emu);
+    int num_found = search(&ow, found);
+    report("ow_romsearch", &emu, o);
+
+    // Pull-up rise time margin: the master samples 15 us after the falling edge.
+    printf("\nrise(ns)  found\n");
+    static const uint32_t rise_ns[] = {500, 2000, 5000, 8000, 9500, 12000};
+    for (size_t i = 0; i < sizeof(rise_ns)/sizeof(rise_ns[0]); i++) {
+        ow_pio_emu_init(&emu, &program, &bus);
+        emu.timing.rise_ns = rise_ns[i];
+        ow_pio_emu_attach(&ow, &emu);
+        printf("%8u  %5d\n", rise_ns[i], search(&ow, found));
+    }
+
+    return (present && verified && num_found == TIMING_DEVICES) ? 0 : 1;
+}
@@ -9,8 +9,10 @@
 #ifndef _DS18B20_H
 #define _DS18B20_H
 
-#include "pico/stdlib.h"
 #include "onewire.h"
+#if !OW_HOST
+#include "pico/stdlib.h"
+#endif
 
 #define DS18B20_FAMILY              0x28    /**< OneWire family code. */
 #define DS18B20_CONVERT_T           0x44    /**< Convert temperature command.*/
@@ -19,6 +21,13 @@
 #define DS18B20_COPY_SCRATCHPAD     0x48    /**< Copy scratchpad command.*/
 #define DS18B20_RECALL_EE           0xb8    /**< Recall EEPROM registers command.*/
 #define DS18B20_READ_POWER_SUPPLY   0xb4    /**< Read power supply command.*/
+#define DS18B20_SCRATCHPAD_SIZE     9       /**< Scratchpad size in bytes, including CRC.*/
+#define DS18B20_CONFIG_9BIT         0x1f    /**< Configuration register value for 9-bit resolution.*/
+#define DS18B20_CONFIG_10BIT        0x3f    /**< Configuration register value for 10-bit resolution.*/
+#define DS18B20_CONFIG_11BIT        0x5f    /**< Configuration register value for 11-bit resolution.*/
+#define DS18B20_CONFIG_12BIT        0x7f    /**< Configuration register value for 12-bit resolution (default).*/
+#define DS18B20_COPY_TIME_MS        10      /**< EEPROM copy time in milliseconds.*/
+#define DS18B20_CONVERT_US          750000  /**< 12-bit conversion time in microseconds; each bit less halves it.*/
 
 /**
  * @brief Command all DS18B20 devices on bus to convert a temperature reading.
@@ -44,4 +53,77 @@ void ds18b20_convert_temperature(OW *ow, uint64_t *romcode);
  */
 int16_t ds18b20_read_temperature(OW *ow, uint64_t *romcode);
 
+/**
+ * @brief Read the scratchpad of a specific device. Returns a boolean indicating CRC status.
+ *
+ * @note An all-zero scratchpad, as read from a shorted bus, has a valid CRC but is reported as a failure.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @param scratchpad Buffer of DS18B20_SCRATCHPAD_SIZE bytes to read into.
+ * @return true
+ * @return false
+ */
+bool ds18b20_read_scratchpad(OW *ow, uint64_t *romcode, uint8_t *scratchpad);
+
+/**
+ * @brief Write the alarm thresholds and configuration register of a device, or of all devices if romcode is NULL.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device, or NULL for all devices.
+ * @param high High alarm threshold (TH) in degrees C.
+ * @param low Low alarm threshold (TL) in degrees C.
+ * @param config Configuration register (e.g. DS18B20_CONFIG_12BIT).
+ */
+void ds18b20_write_scratchpad(OW *ow, uint64_t *romcode, int8_t high, int8_t low, uint8_t config);
+
+/**
+ * @brief Copy the alarm thresholds and configuration register of a device, or of all devices if romcode is NULL,
+ * to EEPROM so that they survive a power cycle.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device, or NULL for all devices.
+ */
+void ds18b20_copy_scratchpad(OW *ow, uint64_t *romcode);
+
+/**
+ * @brief Set the alarm thresholds of a device and read them back. Returns a boolean indicating success status.
+ *
+ * @note A device flags an alarm when its last conversion is at or above high or at or below low. The configuration
+ * register is read and written back unchanged, so a broadcast (NULL romcode) is refused; use
+ * ds18b20_write_scratchpad with an explicit configuration to set every device at once.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @param high High alarm threshold (TH) in degrees C.
+ * @param low Low alarm threshold (TL) in degrees C.
+ * @return true
+ * @return false
+ */
+bool ds18b20_set_alarm(OW *ow, uint64_t *romcode, int8_t high, int8_t low);
+
+/**
+ * @brief Convert on all devices and read back only those outside their alarm thresholds. Returns the number of
+ * devices in alarm, or -1 on a search error.
+ *
+ * @note Each device in alarm is read with ds18b20_read_scratchpad. A device that fails the CRC check has its status
+ * set to false and its temperature set to 0.
+ *
+ * @param ow OneWire instance.
+ * @param romcodes Array of ROM codes of devices in alarm.
+ * @param temps Array of temperatures of devices in alarm (1/16 degrees C).
+ * @param status Array of per-device results (true if the scratchpad read passed its CRC check), or NULL.
+ * @param maxdevs Maximum number of devices (0 means no limit).
+ * @return int
+ */
+int ds18b20_read_alarms(OW *ow, uint64_t *romcodes, int16_t *temps, bool *status, int maxdevs);
+
+/**
+ * @brief Predict the conversion time of a device in microseconds (93.75 ms at 9 bits to 750 ms at 12 bits).
+ *
+ * @param config Configuration register (e.g. DS18B20_CONFIG_12BIT).
+ * @return uint32_t
+ */
+uint32_t ds18b20_cost_convert_us(uint8_t config);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef _DS18B20_SIM_H
+#define _DS18B20_SIM_H
+
+#include "ds18b20.h"
+#include "ow_sim.h"
+
+#define DS18B20_SIM_POWER_ON        0x0550  /**< Scratchpad temperature at power-on (85 C). */
+#define DS18B20_SIM_TH              0x4b    /**< Factory TH register. */
+#define DS18B20_SIM_TL              0x46    /**< Factory TL register. */
+
+/**
+ * @brief Simulated DS18B20.
+ *
+ */
+typedef struct {
+    ow_sim_device dev;                              /**< ROM layer. */
+    int16_t temperature;                            /**< Temperature measured by the next conversion, 1/16 C. */
+    bool parasite;                                  /**< Parasite powered (reads 0 to READ POWER SUPPLY). */
+    bool alarm;                                     /**< Alarm flag from the last conversion. */
+    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];    /**< Scratchpad, including CRC. */
+    uint8_t eeprom[3];                              /**< TH, TL and configuration EEPROM. */
+    uint8_t command;                                /**< Function command since the last reset, or 0. */
+    uint8_t count;                                  /**< Bytes received after the function command. */
+    bool converting;                                /**< Conversion in progress. */
+    uint64_t busy_until_us;                         /**< End of the conversion or EEPROM copy in progress. */
+} ds18b20_sim;
+
+/**
+ * @brief Initialise a simulated DS18B20 at power-on, with factory EEPROM contents. Attach it with ow_sim_attach.
+ *
+ * @param sim Simulated DS18B20.
+ * @param romcode ROM code.
+ * @param temperature Temperature measured by conversions, 1/16 C.
+ */
+void ds18b20_sim_init(ds18b20_sim *sim, uint64_t romcode, int16_t temperature);
+
+#endif
@@ -1,6 +1,9 @@
 #include "ds18b20.h"
+#include "ow_hist.h"
 
 void ds18b20_convert_temperature_all(OW *ow) {
+    OW_HIST_START(ow);
+
     // Send conversion command.
     ow_reset(ow);
     ow_select(ow, NULL);
@@ -8,11 +11,14 @@ void ds18b20_convert_temperature_all(OW *ow) {
 
     // Wait for the conversions to finish.
     while (ow_read(ow) == 0) {
-        sleep_ms(10);
+        ow_sleep_ms(ow, 10);
     }
+    OW_HIST_END(ow, OW_HIST_DS18B20_CONVERT);
 }
 
 void ds18b20_convert_temperature(OW *ow, uint64_t *romcode) {
+    OW_HIST_START(ow);
+
     // Send conversion command.
     ow_reset(ow);
     ow_select(ow, romcode);
@@ -20,11 +26,29 @@ void ds18b20_convert_temperature(OW *ow, uint64_t *romcode) {
 
     // Wait for the conversions to finish.
     while (ow_read(ow) == 0) {
-        sleep_ms(10);
+        ow_sleep_ms(ow, 10);
     }
+    OW_HIST_END(ow, OW_HIST_DS18B20_CONVERT);
+}
+
+/**
+ * @brief Convert the temperature bytes (LSB, MSB) of a scratchpad to 1/16 degrees C.
+ */
+static int16_t ds18b20_temperature(const uint8_t *data) {
+    uint16_t temp12 = (data[1] << 8) + data[0]; // 12-bit temperature.
+
+    // Check if temperature is negative.
+    int sign = 1;
+    if (temp12 > 2047) {
+        temp12 = (~temp12) + 1; // Two's complement to find the magnitude.
+        sign = -1;
+    }
+    return sign * temp12;
 }
 
 int16_t ds18b20_read_temperature(OW *ow, uint64_t *romcode) {
+    OW_HIST_START(ow);
+
     // Send read command.
     ow_reset(ow);
     ow_select(ow, romcode);
@@ -34,15 +58,95 @@ int16_t ds18b20_read_temperature(OW *ow, uint64_t *romcode) {
     uint8_t data[2];
     data[0] = ow_read(ow); // LSB.
     data[1] = ow_read(ow); // MSB.
-    uint16_t temp12 = (data[1] << 8) + data[0]; // 12-bit temperature.
+    int16_t temp = ds18b20_temperature(data);
 
-    // Check if temperature is negative.
-    int sign = 1;
-    if (temp12 > 2047) {
-        temp12 = (~temp12) + 1; // Two's complement to find the magnitude.
-        sign = -1;
+    OW_HIST_END(ow, OW_HIST_DS18B20_READ);
+    return temp;
+}
+
+bool ds18b20_read_scratchpad(OW *ow, uint64_t *romcode, uint8_t *scratchpad) {
+    OW_HIST_START(ow);
+
+    // Send read command.
+    ow_reset(ow);
+    ow_select(ow, romcode);
+    ow_send(ow, DS18B20_READ_SCRATCHPAD);
+
+    // Read the scratchpad and check the CRC byte.
+    for (int i = 0; i < DS18B20_SCRATCHPAD_SIZE; i++) {
+        scratchpad[i] = ow_read(ow);
     }
-    int16_t temp = sign * temp12;
+    // A shorted bus reads all zero, which has a valid CRC, so reject it too.
+    bool valid = ow_crc_8(scratchpad, DS18B20_SCRATCHPAD_SIZE) == 0;
+    bool zero = true;
+    for (int i = 0; i < DS18B20_SCRATCHPAD_SIZE; i++) {
+        zero = zero && scratchpad[i] == 0;
+    }
+    valid = valid && !zero;
+    OW_STATS_ADD(ow, crc8_failures, !valid);
+    OW_HIST_END(ow, OW_HIST_DS18B20_READ);
+    return valid;
+}
 
-    return temp;
+void ds18b20_write_scratchpad(OW *ow, uint64_t *romcode, int8_t high, int8_t low, uint8_t config) {
+    // Send write command followed by TH, TL and configuration bytes.
+    ow_reset(ow);
+    ow_select(ow, romcode);
+    ow_send(ow, DS18B20_WRITE_SCRATCHPAD);
+    ow_send(ow, (uint8_t)high);
+    ow_send(ow, (uint8_t)low);
+    ow_send(ow, config);
+}
+
+void ds18b20_copy_scratchpad(OW *ow, uint64_t *romcode) {
+    // Send copy command.
+    ow_reset(ow);
+    ow_select(ow, romcode);
+    ow_send(ow, DS18B20_COPY_SCRATCHPAD);
+
+    // Wait for the EEPROM write to finish.
+    ow_sleep_ms(ow, DS18B20_COPY_TIME_MS);
+}
+
+bool ds18b20_set_alarm(OW *ow, uint64_t *romcode, int8_t high, int8_t low) {
+    // Devices may differ in resolution, so a broadcast cannot preserve it.
+    if (romcode == NULL) {
+        return false;
+    }
+
+    // Preserve the resolution of the device.
+    uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+    if (!ds18b20_read_scratchpad(ow, romcode, scratchpad)) {
+        return false;
+    }
+    uint8_t config = scratchpad[4];
+    ds18b20_write_scratchpad(ow, romcode, high, low, config);
+
+    // Read back the thresholds and configuration register.
+    if (!ds18b20_read_scratchpad(ow, romcode, scratchpad)) {
+        return false;
+    }
+    return scratchpad[2] == (uint8_t)high && scratchpad[3] == (uint8_t)low && scratchpad[4] == config;
+}
+
+int ds18b20_read_alarms(OW *ow, uint64_t *romcodes, int16_t *temps, bool *status, int maxdevs) {
+    // One conversion for every device, then find only the devices whose alarm flag is set.
+    ds18b20_convert_temperature_all(ow);
+    int num_found = ow_romsearch(ow, romcodes, maxdevs, OW_ALARM_SEARCH);
+
+    // Read the devices in alarm.
+    for (int i = 0; i < num_found; i++) {
+        uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+        bool valid = ds18b20_read_scratchpad(ow, &romcodes[i], scratchpad);
+        temps[i] = valid ? ds18b20_temperature(scratchpad) : 0;
+        if (status != NULL) {
+            status[i] = valid;
+        }
+    }
+    return num_found;
+}
+
+uint32_t ds18b20_cost_convert_us(uint8_t config) {
+    uint resolution = (config >> 5) & 3;    // 0 for 9 bits to 3 for 12 bits.
+    return DS18B20_CONVERT_US >> (3 - resolution);
 }
@@ -0,0 +1,119 @@
+#include "ds18b20_sim.h"
+#include <string.h>
+
+/**
+ * @brief Update the scratchpad CRC byte.
+ */
+static void ds18b20_sim_crc(ds18b20_sim *sim) {
+    sim->scratchpad[8] = ow_crc_8(sim->scratchpad, 8);
+}
+
+/**
+ * @brief Finish a conversion once its time has passed: latch the temperature and update the alarm flag.
+ */
+static void ds18b20_sim_update(ds18b20_sim *sim) {
+    if (!sim->converting || sim->dev.bus->now_us < sim->busy_until_us) {
+        return;
+    }
+    sim->converting = false;
+
+    // Undefined bits at lower resolutions read as 0.
+    uint resolution = (sim->scratchpad[4] >> 5) & 3;
+    uint16_t raw = (uint16_t)sim->temperature & ~((1u << (3 - resolution)) - 1);
+    sim->scratchpad[0] = (uint8_t)raw;
+    sim->scratchpad[1] = (uint8_t)(raw >> 8);
+    ds18b20_sim_crc(sim);
+
+    // The alarm compares the integer part with TH and TL.
+    int8_t degrees = (int8_t)((int16_t)raw >> 4);
+    sim->alarm = degrees >= (int8_t)sim->scratchpad[2] || degrees <= (int8_t)sim->scratchpad[3];
+}
+
+static void ds18b20_sim_reset(ow_sim_device *dev) {
+    ds18b20_sim *sim = (ds18b20_sim *)dev;
+    ds18b20_sim_update(sim);
+    sim->command = 0;
+    sim->count = 0;
+}
+
+static void ds18b20_sim_receive(ow_sim_device *dev, uint8_t byte) {
+    ds18b20_sim *sim = (ds18b20_sim *)dev;
+    ds18b20_sim_update(sim);
+    if (sim->command == DS18B20_WRITE_SCRATCHPAD) {
+        // TH, TL and configuration; only the resolution bits of the configuration are writable.
+        if (sim->count < 3) {
+            sim->scratchpad[2 + sim->count] = sim->count == 2 ? (byte & 0x60) | 0x1f : byte;
+            sim->count += 1;
+            ds18b20_sim_crc(sim);
+        }
+        return;
+    } else if (sim->command != 0) {
+        return;                     // Read slots while busy or after a response.
+    }
+
+    sim->command = byte;
+    uint64_t now = dev->bus->now_us;
+    switch (byte) {
+        case DS18B20_CONVERT_T:
+            sim->converting = true;
+            sim->busy_until_us = now + ds18b20_cost_convert_us(sim->scratchpad[4]);
+            break;
+        case DS18B20_READ_SCRATCHPAD:
+            ow_sim_transmit(dev, sim->scratchpad, DS18B20_SCRATCHPAD_SIZE);
+            break;
+        case DS18B20_COPY_SCRATCHPAD:
+            memcpy(sim->eeprom, &sim->scratchpad[2], sizeof(sim->eeprom));
+            sim->busy_until_us = now + DS18B20_COPY_TIME_MS * 1000;
+            break;
+        case DS18B20_RECALL_EE:
+            memcpy(&sim->scratchpad[2], sim->eeprom, sizeof(sim->eeprom));
+            ds18b20_sim_crc(sim);
+            break;
+        default:
+            break;
+    }
+}
+
+static uint ds18b20_sim_idle_bit(ow_sim_device *dev) {
+    ds18b20_sim *sim = (ds18b20_sim *)dev;
+    ds18b20_sim_update(sim);
+    switch (sim->command) {
+        case DS18B20_CONVERT_T:
+        case DS18B20_COPY_SCRATCHPAD:
+            // Busy reads 0, unless parasite powered (the master must wait the maximum time instead).
+            return sim->parasite || dev->bus->now_us >= sim->busy_until_us;
+        case DS18B20_READ_POWER_SUPPLY:
+            return !sim->parasite;
+        default:
+            return 1;
+    }
+}
+
+static bool ds18b20_sim_alarm(ow_sim_device *dev) {
+    ds18b20_sim *sim = (ds18b20_sim *)dev;
+    ds18b20_sim_update(sim);
+    return sim->alarm;
+}
+
+static const ow_sim_device_ops ds18b20_sim_ops = {
+    ds18b20_sim_reset,
+    ds18b20_sim_receive,
+    ds18b20_sim_idle_bit,
+    ds18b20_sim_alarm,
+}; /**< DS18B20 function layer. */
+
+void ds18b20_sim_init(ds18b20_sim *sim, uint64_t romcode, int16_t temperature) {
+    memset(sim, 0, sizeof(*sim));
+    ow_sim_device_init(&sim->dev, romcode, &ds18b20_sim_ops);
+    sim->temperature = temperature;
+    sim->eeprom[0] = DS18B20_SIM_TH;
+    sim->eeprom[1] = DS18B20_SIM_TL;
+    sim->eeprom[2] = DS18B20_CONFIG_12BIT;
+    sim->scratchpad[0] = (uint8_t)DS18B20_SIM_POWER_ON;
+    sim->scratchpad[1] = (uint8_t)(DS18B20_SIM_POWER_ON >> 8);
+    memcpy(&sim->scratchpad[2], sim->eeprom, sizeof(sim->eeprom));
+    sim->scratchpad[5] = 0xff;
+    sim->scratchpad[6] = 0x0c;
+    sim->scratchpad[7] = 0x10;
+    ds18b20_sim_crc(sim);
+}
@@ -1,9 +1,11 @@
 #ifndef _DS2431_H
 #define _DS2431_H
 
+#include "onewire.h"
+#if !OW_HOST
 #include "pico/stdio.h"
 #include "pico/time.h"
-#include "onewire.h"
+#endif
 #include <string.h>
 
 #define DS2431_FAMILY               0x2d    /**< OneWire family byte.*/
@@ -17,13 +19,36 @@
 #define DS2431_SIZE                 128     /**< Memory size in bytes.*/
 #define DS2431_PAGES                4       /**< Memory size in pages.*/
 #define DS2431_ROW_SIZE             8       /**< Memory row size in bytes.*/
+#define DS2431_ROWS                 16      /**< Memory size in rows.*/
 #define DS2431_WRITE_CMD_SIZE       3       /**< Write command size.*/
 #define DS2431_READ_CMD_SIZE        4       /**< Read command size.*/
 #define DS2431_COPY_CMD_SIZE        4       /**< Copy command size.*/
 #define DS2431_READ_RETRY           2       /**< Maximum read retry attempts.*/
+#define DS2431_PROG_US              10000   /**< Maximum copy programming time (tPROG) in microseconds.*/
+#define DS2431_POLL_US              500     /**< Bus idle time between copy status polls in microseconds.*/
+
+#ifndef DS2431_PROG_MIN_US
+#define DS2431_PROG_MIN_US          DS2431_PROG_US  /**< Bus idle time before the first copy status poll in microseconds.*/
+#endif
+
+#define DS2431_COPY_BUSY            0       /**< Copy still programming.*/
+#define DS2431_COPY_DONE            1       /**< Copy completed.*/
+#define DS2431_COPY_FAILED          2       /**< Copy rejected or not completed within tPROG.*/
+
+/**
+ * @brief Copy of a row in progress (see ds2431_write_row_start).
+ *
+ */
+typedef struct {
+    uint64_t deadline_us;   /**< Time by which programming must have completed. */
+    uint64_t next_poll_us;  /**< Time of the next status poll. */
+} ds2431_copy;
 
 /**
  * @brief Write arbitrary length buffer to EEPROM. Returns a boolean indicating success status.
+ *
+ * @note The address and length need not be row aligned. The rows touched are read first with ds2431_read_stable,
+ * partial rows are merged with their current contents and rows that already hold the data are not programmed.
  * 
  * @param ow OneWire instance.
  * @param romcode ROM code of target device.
@@ -37,6 +62,8 @@ bool ds2431_write(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer,
 
 /**
  * @brief Write a row to EEPROM. Returns a boolean indicating success status. 
+ *
+ * @note The copy is waited for with ds2431_copy_poll (see its note on polling during programming).
  * 
  * @param ow OneWire instance.
  * @param romcode ROM code of target device.
@@ -48,6 +75,70 @@ bool ds2431_write(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer,
  */
 bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len);
 
+/**
+ * @brief Write and verify a row and start copying it to EEPROM, without waiting for the copy to complete. Returns a
+ * boolean indicating the copy was started.
+ *
+ * @note The scratchpad is read back (again after a CRC failure, up to DS2431_READ_RETRY reads) and its address, E/S
+ * and data are checked before COPY SCRATCHPAD is sent. The device stays selected while it programs, so leave the bus
+ * idle and call ds2431_copy_poll until it reports completion.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @param address Address to write to.
+ * @param buffer Buffer to write bytes from.
+ * @param len Length of buffer.
+ * @param copy Copy in progress.
+ * @return true
+ * @return false
+ */
+bool ds2431_write_row_start(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len,
+                            ds2431_copy* copy);
+
+/**
+ * @brief Check a copy started by ds2431_write_row_start. Returns DS2431_COPY_BUSY, DS2431_COPY_DONE or
+ * DS2431_COPY_FAILED.
+ *
+ * @note Before the next poll is due this returns DS2431_COPY_BUSY without using the bus. The bus stays idle for
+ * DS2431_PROG_MIN_US after the copy starts, then a poll every DS2431_POLL_US reads one status byte: all ones while
+ * the device programs, then the alternating pattern of DS2431_SUCCESS. Polling stops with DS2431_COPY_FAILED once
+ * tPROG has passed without completion.
+ *
+ * @note The DS2431 takes its programming current from the bus, and the datasheet asks for the bus to stay high for
+ * tPROG, so by default DS2431_PROG_MIN_US is tPROG and the first poll only reads the status. Where the devices are
+ * known to program reliably with read slots on the bus (e.g. a strong pull-up), define a smaller DS2431_PROG_MIN_US
+ * (e.g. 5000) to detect completion early.
+ *
+ * @param ow OneWire instance.
+ * @param copy Copy in progress.
+ * @return int
+ */
+int ds2431_copy_poll(OW* ow, ds2431_copy* copy);
+
+/**
+ * @brief Write the same rows to several devices at once. Returns the number of devices written and verified.
+ *
+ * @note Each row is written to every scratchpad with OW_SKIP_ROM, verified on each device with OW_MATCH_ROM and
+ * rewritten on the devices that fail, then copied on every device with one OW_SKIP_ROM copy, so that the devices
+ * program together. A device whose scratchpad still fails is left with an incomplete scratchpad so that it rejects
+ * the copy. Each device is read back once at the end. The address and length must be row aligned.
+ *
+ * @note Unlike ds2431_write_row, the copy status is not polled: all devices answer a read slot together, so the
+ * success pattern of the first device to finish hides those still programming. Each row copy waits DS2431_PROG_US
+ * with the bus idle.
+ *
+ * @param ow OneWire instance.
+ * @param romcodes ROM codes of target devices (no other devices may be on the bus).
+ * @param num_devices Number of devices.
+ * @param address Address to write to.
+ * @param buffer Buffer of bytes to write.
+ * @param len Length of buffer to write.
+ * @param status Array of per-device results (true if written and verified), or NULL.
+ * @return int
+ */
+int ds2431_write_fleet(OW* ow, uint64_t* romcodes, int num_devices, uint16_t address, uint8_t* buffer, size_t len,
+                       bool* status);
+
 /**
  * @brief Read from EEPROM. Returns a boolean indicating success status.
  * 
@@ -61,6 +152,22 @@ bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buff
  */
 bool ds2431_read(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len);
 
+/**
+ * @brief Read from EEPROM until two consecutive reads agree. Returns a boolean indicating success status.
+ *
+ * @note READ MEMORY has no CRC, so a bit flipped on the bus is not otherwise detected. The range is read again up to
+ * DS2431_READ_RETRY times, and the function fails if no two consecutive reads match.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @param address Address to read from.
+ * @param buffer Buffer to write bytes to.
+ * @param len Length of buffer.
+ * @return true
+ * @return false
+ */
+bool ds2431_read_stable(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len);
+
 /**
  * @brief Clear EEPROM. Returns a boolean indicating success status.
  * 
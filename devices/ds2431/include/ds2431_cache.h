@@ -0,0 +1,68 @@
+#ifndef _DS2431_CACHE_H
+#define _DS2431_CACHE_H
+
+#include "ds2431.h"
+
+/**
+ * @brief RAM shadow of the memory of a DS2431, with a dirty flag per row.
+ *
+ */
+typedef struct {
+    OW *ow;                         /**< OneWire instance. */
+    uint64_t romcode;               /**< ROM code of the device. */
+    uint8_t memory[DS2431_SIZE];    /**< Memory image. */
+    uint16_t dirty;                 /**< Rows changed since they were last written (bit per row). */
+} ds2431_cache;
+
+/**
+ * @brief Load the memory of a DS2431 into a cache. Returns a boolean indicating success status.
+ *
+ * @note The memory is read with ds2431_read_stable, since a flush merges the rest of each dirty row from the cache.
+ *
+ * @param cache Cache.
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @return true
+ * @return false
+ */
+bool ds2431_cache_load(ds2431_cache *cache, OW *ow, uint64_t *romcode);
+
+/**
+ * @brief Read from a cache, without using the bus. Returns a boolean indicating success status.
+ *
+ * @param cache Cache.
+ * @param address Address to read from.
+ * @param buffer Buffer to write bytes to.
+ * @param len Length of buffer.
+ * @return true
+ * @return false
+ */
+bool ds2431_cache_read(const ds2431_cache *cache, uint16_t address, uint8_t *buffer, size_t len);
+
+/**
+ * @brief Write to a cache, without using the bus. Returns a boolean indicating success status.
+ *
+ * @note Only rows whose contents change are marked dirty.
+ *
+ * @param cache Cache.
+ * @param address Address to write to.
+ * @param buffer Buffer of bytes to write.
+ * @param len Length of buffer.
+ * @return true
+ * @return false
+ */
+bool ds2431_cache_write(ds2431_cache *cache, uint16_t address, const uint8_t *buffer, size_t len);
+
+/**
+ * @brief Write the dirty rows of a cache to the device with ds2431_write_row. Returns a boolean indicating success
+ * status.
+ *
+ * @note Rows that fail stay dirty, so the flush can be retried.
+ *
+ * @param cache Cache.
+ * @return true
+ * @return false
+ */
+bool ds2431_cache_flush(ds2431_cache *cache);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef _DS2431_LOG_H
+#define _DS2431_LOG_H
+
+#include "ds2431.h"
+
+#define DS2431_LOG_HEADER_SIZE  3       /**< Record header: sequence number, key and data length. */
+#define DS2431_LOG_OVERHEAD     4       /**< Record header and inverted CRC-8. */
+#define DS2431_LOG_MAX_ROWS     8       /**< Maximum rows per record. */
+#define DS2431_LOG_MAX_DATA     (DS2431_LOG_MAX_ROWS * DS2431_ROW_SIZE - DS2431_LOG_OVERHEAD) /**< Maximum data per record. */
+#define DS2431_LOG_EVENT        0       /**< Key of records that are dropped rather than kept when the log wraps. */
+
+/**
+ * @brief Record of a DS2431 log.
+ *
+ */
+typedef struct {
+    uint8_t row;            /**< First row (records wrap from the last row to the first). */
+    uint8_t rows;           /**< Rows used. */
+    uint8_t key;            /**< Key. */
+    uint8_t len;            /**< Data length. */
+} ds2431_log_entry;
+
+/**
+ * @brief Append-only record store in the memory of a DS2431.
+ *
+ * @note Each record starts on a row and holds its sequence number, key, data length, data and an inverted CRC-8,
+ * so records of up to 4 data bytes take a single row. Records are written in a ring after the newest one. When the
+ * ring is full, the oldest records are dropped, except the newest record of each key other than DS2431_LOG_EVENT,
+ * which is written again after the newest record before its rows are reused, so that a power failure during an
+ * append loses at most the record being appended. A record with no data marks its key deleted and is not kept.
+ */
+typedef struct {
+    OW *ow;                                 /**< OneWire instance. */
+    uint64_t romcode;                       /**< ROM code of the device. */
+    uint8_t memory[DS2431_SIZE];            /**< Memory image. */
+    ds2431_log_entry entries[DS2431_ROWS];  /**< Records, oldest first. */
+    uint8_t count;                          /**< Number of records. */
+    uint8_t head;                           /**< Row of the next record. */
+    uint8_t seq;                            /**< Sequence number of the next record. */
+} ds2431_log;
+
+/**
+ * @brief Mount the log of a DS2431, reading its memory once. Returns a boolean indicating success status.
+ *
+ * @note A device whose memory holds no valid records mounts as an empty log.
+ *
+ * @param log Log.
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @return true
+ * @return false
+ */
+bool ds2431_log_mount(ds2431_log *log, OW *ow, uint64_t *romcode);
+
+/**
+ * @brief Append a record. Returns a boolean indicating success status.
+ *
+ * @note Unless the ring is full, only the rows of the new record are programmed. Fails without writing if the
+ * records that must be kept (including the one this record replaces, until it is written), the new record and room
+ * to move the largest kept record do not fit in the ring; after a write error the log is mounted again.
+ *
+ * @param log Log.
+ * @param key Key (DS2431_LOG_EVENT for records that are not kept).
+ * @param data Data.
+ * @param len Length of data (up to DS2431_LOG_MAX_DATA).
+ * @return true
+ * @return false
+ */
+bool ds2431_log_append(ds2431_log *log, uint8_t key, const uint8_t *data, size_t len);
+
+/**
+ * @brief Get the number of records in the log.
+ *
+ * @param log Log.
+ * @return int
+ */
+int ds2431_log_count(const ds2431_log *log);
+
+/**
+ * @brief Get a record, oldest first. Returns its data length, or -1 if there is no such record or it does not fit.
+ *
+ * @param log Log.
+ * @param index Record index.
+ * @param key Key of the record, or NULL.
+ * @param buffer Buffer to write data to.
+ * @param size Size of buffer.
+ * @return int
+ */
+int ds2431_log_get(const ds2431_log *log, int index, uint8_t *key, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Get the newest record of a key. Returns its data length (0 once the key is deleted), or -1 if the key has
+ * no record or it does not fit.
+ *
+ * @param log Log.
+ * @param key Key.
+ * @param buffer Buffer to write data to.
+ * @param size Size of buffer.
+ * @return int
+ */
+int ds2431_log_find(const ds2431_log *log, uint8_t key, uint8_t *buffer, size_t size);
+
+#endif
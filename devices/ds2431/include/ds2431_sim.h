@@ -0,0 +1,43 @@
+#ifndef _DS2431_SIM_H
+#define _DS2431_SIM_H
+
+#include "ds2431.h"
+#include "ow_sim.h"
+
+#define DS2431_SIM_MEMORY_SIZE  0x90    /**< Data memory and register page. */
+#define DS2431_SIM_PROG_US      10000   /**< Default EEPROM programming time (tPROG maximum). */
+#define DS2431_SIM_AA           0x80    /**< Authorization accepted flag in E/S. */
+#define DS2431_SIM_PF           0x20    /**< Partial flag in E/S. */
+
+/**
+ * @brief Simulated DS2431.
+ *
+ */
+typedef struct {
+    ow_sim_device dev;                              /**< ROM layer. */
+    uint8_t memory[DS2431_SIM_MEMORY_SIZE];         /**< EEPROM contents. */
+    uint8_t scratchpad[DS2431_ROW_SIZE];            /**< Scratchpad. */
+    uint8_t ta1;                                    /**< Target address, low byte. */
+    uint8_t ta2;                                    /**< Target address, high byte. */
+    uint8_t es;                                     /**< Ending offset and status (E/S). */
+    uint8_t command;                                /**< Function command since the last reset, or 0. */
+    uint8_t count;                                  /**< Bytes received after the function command. */
+    uint8_t auth[3];                                /**< Authorization pattern received by COPY SCRATCHPAD. */
+    bool copied;                                    /**< Authorization accepted by the current COPY SCRATCHPAD. */
+    uint16_t address;                               /**< READ MEMORY address. */
+    uint32_t prog_us;                               /**< EEPROM programming time. */
+    uint64_t busy_until_us;                         /**< End of the copy in progress. */
+    uint8_t corrupt_reads;                          /**< READ SCRATCHPAD responses still to corrupt (fault injection). */
+    uint8_t corrupt_memory_reads;                   /**< READ MEMORY responses still to corrupt (fault injection). */
+    int copies_left;                                /**< Copies still programmed before power is lost, or -1 (fault injection). */
+} ds2431_sim;
+
+/**
+ * @brief Initialise a simulated DS2431 with erased memory. Attach it with ow_sim_attach.
+ *
+ * @param sim Simulated DS2431.
+ * @param romcode ROM code.
+ */
+void ds2431_sim_init(ds2431_sim *sim, uint64_t romcode);
+
+#endif
@@ -1,38 +1,54 @@
 #include "ds2431.h"
+#include "ow_hist.h"
 
 bool ds2431_write(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len) {
-    // Check address is valid (within memory scope and divisible by 8).
-    if (address >= DS2431_SIZE || address % 8 != 0) {
+    // Check the range is within memory scope.
+    if (address > DS2431_SIZE || len > (size_t)(DS2431_SIZE - address)) {
         return false;
     }
+    if (len == 0) {
+        return true;
+    }
 
-    // Check buffer length is less than memory size.
-    if (len > DS2431_SIZE) {
+    // Read the current contents of every row the range touches. They decide which rows are skipped and which
+    // neighbouring bytes are programmed, so they must not come from a corrupted read.
+    uint16_t start = address - address % DS2431_ROW_SIZE;
+    uint16_t end = address + len + (DS2431_ROW_SIZE - 1) - (address + len - 1) % DS2431_ROW_SIZE;
+    uint8_t rows[DS2431_SIZE];
+    if (!ds2431_read_stable(ow, romcode, start, rows, end - start)) {
         return false;
     }
 
-    // Write row by row.
-    uint8_t count = 0;
-    bool success;
-    uint8_t* row = &buffer[0];
-    while (count < len) {
-        success = ds2431_write_row(ow, romcode, address, row, DS2431_ROW_SIZE);
-        address += DS2431_ROW_SIZE;
-        row += DS2431_ROW_SIZE;
-        count += DS2431_ROW_SIZE;
+    // Merge the buffer into the rows and program only those that change.
+    bool success = true;
+    for (uint16_t row = start; row < end; row += DS2431_ROW_SIZE) {
+        uint8_t* current = &rows[row - start];
+        uint16_t first = row < address ? address : row;
+        uint16_t last = address + len;
+        if (last > row + DS2431_ROW_SIZE) {
+            last = row + DS2431_ROW_SIZE;
+        }
+        if (memcmp(&current[first - row], &buffer[first - address], last - first) == 0) {
+            continue;
+        }
+        memcpy(&current[first - row], &buffer[first - address], last - first);
+        if (!ds2431_write_row(ow, romcode, row, current, DS2431_ROW_SIZE)) {
+            success = false;
+        }
     }
     return success;
 }
 
-bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len) {
+bool ds2431_write_row_start(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len,
+                            ds2431_copy* copy) {
     // Prepare command.
-    uint8_t TA1 = address << 0;
-    uint8_t TA2 = address << 8;
+    uint8_t TA1 = address >> 0;
+    uint8_t TA2 = address >> 8;
     uint8_t command[DS2431_WRITE_CMD_SIZE+len];
     command[0] = DS2431_WRITE_SCRATCHPAD;                                   // Command.
     command[1] = TA1;                                                       // Offset.
     command[2] = TA2;                                                       // Address.
-    for (int i=DS2431_WRITE_CMD_SIZE; i<DS2431_WRITE_CMD_SIZE+len; i++) {   // Data.
+    for (size_t i=DS2431_WRITE_CMD_SIZE; i<DS2431_WRITE_CMD_SIZE+len; i++) {   // Data.
         command[i] = buffer[i-DS2431_WRITE_CMD_SIZE];
     }
 
@@ -44,7 +60,7 @@ bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buff
     ow_select(ow, romcode);
 
     // Send command.
-    for (int i=0; i<sizeof(command); i++) {
+    for (size_t i=0; i<sizeof(command); i++) {
         ow_send(ow, command[i]);
     }
 
@@ -56,14 +72,16 @@ bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buff
     // Check CRC.
     bool valid = ow_check_crc_16(command, sizeof(command), inverted_crc_16);
     if (!valid) {
+        OW_STATS_ADD(ow, crc16_failures, 1);
         return false;
     }
 
-    // Verify scratchpad contents.
-    uint8_t error_count = 0;
-    bool verify = false;
+    // Verify scratchpad contents, reading it again after a CRC failure.
     uint8_t check[DS2431_READ_CMD_SIZE+len];
-    do {
+    valid = false;
+    for (int attempt=0; !valid && attempt<DS2431_READ_RETRY; attempt++) {
+        OW_STATS_ADD(ow, verify_retries, attempt > 0);
+
         // Select device.
         present = ow_reset(ow);
         if (!present) {
@@ -77,44 +95,36 @@ bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buff
         check[1] = ow_read(ow);                         // TA1.
         check[2] = ow_read(ow);                         // TA2.
         check[3] = ow_read(ow);                         // E/S.
-        if (check[3] != DS2431_PF_MASK) {
-            verify = true;
+        for (size_t i=DS2431_READ_CMD_SIZE; i<DS2431_READ_CMD_SIZE+len; i++) { // Data.
+            check[i] = ow_read(ow);
         }
 
-        // Verify data integrity.
-        if (verify) {
-            // Read the data.
-            for (int i=DS2431_READ_CMD_SIZE; i<DS2431_READ_CMD_SIZE+len; i++) { // Data.
-                check[i] = ow_read(ow);
-            }
-            // Read inverted CRC.
-            inverted_crc_16[0] = ow_read(ow);
-            inverted_crc_16[1] = ow_read(ow);
-
-            // Check CRC.
-            valid = ow_check_crc_16(check, sizeof(check), inverted_crc_16);
-            if (!valid) {
-                error_count++;
-                continue;
-            }
+        // Read inverted CRC.
+        inverted_crc_16[0] = ow_read(ow);
+        inverted_crc_16[1] = ow_read(ow);
 
-            // Check address.
-            if (address != ((check[2] << 8) + check[1])) {      
-                return false;       
-            }
+        // Check CRC.
+        valid = ow_check_crc_16(check, sizeof(check), inverted_crc_16);
+        OW_STATS_ADD(ow, crc16_failures, !valid);
+    }
+    if (!valid) {
+        return false;
+    }
 
-            // Check transfer length.
-            if (check[3] != DS2431_PF_MASK) {
-                return false;
-            }
+    // Check address.
+    if (address != ((check[2] << 8) + check[1])) {
+        return false;
+    }
 
-            // Compare scratchpad to buffer.
-            if (memcmp(&check[4], buffer, 8) != 0) {
-                return false;
-            }
-        }
-        break;
-    } while (error_count < DS2431_READ_RETRY);
+    // Check transfer length.
+    if (check[3] != DS2431_PF_MASK) {
+        return false;
+    }
+
+    // Compare scratchpad to buffer.
+    if (memcmp(&check[DS2431_READ_CMD_SIZE], buffer, len) != 0) {
+        return false;
+    }
 
     // Select device.
     present = ow_reset(ow);
@@ -131,23 +141,67 @@ bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buff
     for (int i=0; i<DS2431_COPY_CMD_SIZE; i++) {
         ow_send(ow, command[i]);
     }
-    sleep_ms(15);
+
+    // Programming starts now.
+    uint64_t now = ow_time_us(ow);
+    copy->deadline_us = now + DS2431_PROG_US;
+    copy->next_poll_us = now + DS2431_PROG_MIN_US;    // Keep the bus idle while the device programs.
+    return true;
+}
+
+int ds2431_copy_poll(OW* ow, ds2431_copy* copy) {
+    uint64_t now = ow_time_us(ow);
+    if (now < copy->next_poll_us) {
+        return DS2431_COPY_BUSY;
+    }
 
     // Check copy status.
-    uint8_t success = ow_read(ow) & DS2431_SUCCESS;
-    if (!success) {
-        return false;    
+    uint8_t status = ow_read(ow);
+    if (status != 0xFF && status != DS2431_SUCCESS && status != (uint8_t)~DS2431_SUCCESS) {
+        status = ow_read(ow);       // Programming ended within the byte; the next one is all pattern.
     }
-    return true;
+    if (status == DS2431_SUCCESS || status == (uint8_t)~DS2431_SUCCESS) {
+        return DS2431_COPY_DONE;
+    }
+    if (status != 0xFF || now >= copy->deadline_us) {
+        return DS2431_COPY_FAILED;
+    }
+    copy->next_poll_us = ow_time_us(ow) + DS2431_POLL_US;
+    return DS2431_COPY_BUSY;
+}
+
+/**
+ * @brief Write, verify and copy a row, waiting for the copy (see ds2431_write_row).
+ */
+static bool ds2431_write_row_copy(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len) {
+    ds2431_copy copy;
+    if (!ds2431_write_row_start(ow, romcode, address, buffer, len, &copy)) {
+        return false;
+    }
+    int status;
+    while ((status = ds2431_copy_poll(ow, &copy)) == DS2431_COPY_BUSY) {
+        uint64_t now = ow_time_us(ow);
+        if (copy.next_poll_us > now) {
+            ow_sleep_us(ow, (uint32_t)(copy.next_poll_us - now));
+        }
+    }
+    return status == DS2431_COPY_DONE;
+}
+
+bool ds2431_write_row(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len) {
+    OW_HIST_START(ow);
+    bool success = ds2431_write_row_copy(ow, romcode, address, buffer, len);
+    OW_HIST_END(ow, OW_HIST_DS2431_WRITE);
+    return success;
 }
 
 bool ds2431_read(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len) {
-    // Check address is valid (within memory scope and divisible by 8).
-    if (address >= DS2431_SIZE || address % 8 != 0) {
+    // Check the range is within memory scope.
+    if (address > DS2431_SIZE || len > (size_t)(DS2431_SIZE - address)) {
         return false;
     }
-    uint8_t TA1 = address << 0;
-    uint8_t TA2 = address << 8;
+    uint8_t TA1 = address >> 0;
+    uint8_t TA2 = address >> 8;
 
     // Select device.
     bool present = ow_reset(ow);
@@ -160,9 +214,140 @@ bool ds2431_read(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, s
     ow_send(ow, DS2431_READ_MEMORY);    // Command.
     ow_send(ow, TA1);                   // Offset
     ow_send(ow, TA2);                   // Address.
-    for (int i=0; i<len; i++) {              // Data.
+    for (size_t i=0; i<len; i++) {              // Data.
         buffer[i] = ow_read(ow);
     }
+    return true;
+}
+
+bool ds2431_read_stable(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* buffer, size_t len) {
+    if (!ds2431_read(ow, romcode, address, buffer, len)) {
+        return false;
+    }
+
+    // READ MEMORY has no CRC: read again until two reads in a row agree.
+    uint8_t again[DS2431_SIZE];
+    for (int attempt=0; attempt<DS2431_READ_RETRY; attempt++) {
+        OW_STATS_ADD(ow, verify_retries, attempt > 0);
+        if (!ds2431_read(ow, romcode, address, again, len)) {
+            return false;
+        }
+        if (memcmp(buffer, again, len) == 0) {
+            return true;
+        }
+        memcpy(buffer, again, len);
+    }
+    return false;
+}
+
+/**
+ * @brief Write a row, or only its first len bytes, to the scratchpad of a device (or of all devices when romcode is
+ * NULL). Returns a boolean indicating presence.
+ */
+static bool ds2431_fleet_write_scratchpad(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* row, size_t len) {
+    if (!ow_reset(ow)) {
+        return false;
+    }
+    ow_select(ow, romcode);
+    ow_send(ow, DS2431_WRITE_SCRATCHPAD);
+    ow_send(ow, address >> 0);
+    ow_send(ow, address >> 8);
+    for (size_t i=0; i<len; i++) {
+        ow_send(ow, row[i]);
+    }
+    return true;
+}
+
+/**
+ * @brief Check that the scratchpad of a device holds a complete row. Returns a boolean indicating success status.
+ */
+static bool ds2431_fleet_check_scratchpad(OW* ow, uint64_t* romcode, uint16_t address, uint8_t* row) {
+    if (!ow_reset(ow)) {
+        return false;
+    }
+    ow_select(ow, romcode);
+    ow_send(ow, DS2431_READ_SCRATCHPAD);
+    uint8_t check[DS2431_READ_CMD_SIZE+DS2431_ROW_SIZE];
+    check[0] = DS2431_READ_SCRATCHPAD;
+    for (size_t i=1; i<sizeof(check); i++) {
+        check[i] = ow_read(ow);
+    }
+    uint8_t inverted_crc_16[2];
+    inverted_crc_16[0] = ow_read(ow);
+    inverted_crc_16[1] = ow_read(ow);
+    if (!ow_check_crc_16(check, sizeof(check), inverted_crc_16)) {
+        OW_STATS_ADD(ow, crc16_failures, 1);
+        return false;
+    }
+    return address == ((check[2] << 8) + check[1]) && check[3] == DS2431_PF_MASK &&
+           memcmp(&check[DS2431_READ_CMD_SIZE], row, DS2431_ROW_SIZE) == 0;
+}
+
+int ds2431_write_fleet(OW* ow, uint64_t* romcodes, int num_devices, uint16_t address, uint8_t* buffer, size_t len,
+                       bool* status) {
+    // Check the range is within memory scope and row aligned.
+    bool valid = address % DS2431_ROW_SIZE == 0 && len % DS2431_ROW_SIZE == 0 && address <= DS2431_SIZE &&
+                 len <= (size_t)(DS2431_SIZE - address);
+    bool ok[num_devices > 0 ? num_devices : 1];
+    for (int d=0; d<num_devices; d++) {
+        ok[d] = valid;
+    }
+
+    for (size_t offset=0; valid && offset<len; offset+=DS2431_ROW_SIZE) {
+        uint16_t row_address = address + offset;
+        uint8_t* row = &buffer[offset];
+
+        // Write every scratchpad at once, then verify each and rewrite those that fail.
+        if (!ds2431_fleet_write_scratchpad(ow, NULL, row_address, row, DS2431_ROW_SIZE)) {
+            valid = false;
+            break;
+        }
+        for (int d=0; d<num_devices; d++) {
+            bool verified = ds2431_fleet_check_scratchpad(ow, &romcodes[d], row_address, row);
+            for (int retry=0; !verified && retry<DS2431_READ_RETRY; retry++) {
+                OW_STATS_ADD(ow, verify_retries, 1);
+                ds2431_fleet_write_scratchpad(ow, &romcodes[d], row_address, row, DS2431_ROW_SIZE);
+                verified = ds2431_fleet_check_scratchpad(ow, &romcodes[d], row_address, row);
+            }
+            if (!verified) {
+                // Leave the scratchpad incomplete (E/S partial), so the authorization of the copy fails.
+                ds2431_fleet_write_scratchpad(ow, &romcodes[d], row_address, row, 0);
+                ok[d] = false;
+            }
+        }
+
+        // Copy on every device at once; their programming times overlap.
+        if (!ow_reset(ow)) {
+            valid = false;
+            break;
+        }
+        ow_select(ow, NULL);
+        ow_send(ow, DS2431_COPY_SCRATCHPAD);
+        ow_send(ow, row_address >> 0);
+        ow_send(ow, row_address >> 8);
+        ow_send(ow, DS2431_PF_MASK);
+
+        // Polling cannot be used here: the bus is a wired-AND of every device, so the first device to finish already
+        // drives the success pattern while others may still be programming. Wait the whole tPROG instead, with the
+        // bus idle, and rely on the read back below to check each copy.
+        ow_sleep_us(ow, DS2431_PROG_US);
+    }
+
+    // Read each device back.
+    int num_written = 0;
+    for (int d=0; d<num_devices; d++) {
+        if (valid && ok[d]) {
+            uint8_t check[DS2431_SIZE];
+            ok[d] = ds2431_read(ow, &romcodes[d], address, check, len) && memcmp(check, buffer, len) == 0;
+        } else {
+            ok[d] = false;
+        }
+        num_written += ok[d];
+        if (status != NULL) {
+            status[d] = ok[d];
+        }
+    }
+    return num_written;
 }
 
 bool ds2431_clear(OW* ow, uint64_t* romcode) {
@@ -0,0 +1,46 @@
+#include "ds2431_cache.h"
+
+bool ds2431_cache_load(ds2431_cache *cache, OW *ow, uint64_t *romcode) {
+    cache->ow = ow;
+    cache->romcode = *romcode;
+    cache->dirty = 0;
+    return ds2431_read_stable(ow, romcode, DS2431_START, cache->memory, DS2431_SIZE);
+}
+
+bool ds2431_cache_read(const ds2431_cache *cache, uint16_t address, uint8_t *buffer, size_t len) {
+    if (address > DS2431_SIZE || len > (size_t)(DS2431_SIZE - address)) {
+        return false;
+    }
+    memcpy(buffer, &cache->memory[address], len);
+    return true;
+}
+
+bool ds2431_cache_write(ds2431_cache *cache, uint16_t address, const uint8_t *buffer, size_t len) {
+    if (address > DS2431_SIZE || len > (size_t)(DS2431_SIZE - address)) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        uint16_t a = address + i;
+        if (cache->memory[a] != buffer[i]) {
+            cache->memory[a] = buffer[i];
+            cache->dirty |= 1u << (a / DS2431_ROW_SIZE);
+        }
+    }
+    return true;
+}
+
+bool ds2431_cache_flush(ds2431_cache *cache) {
+    bool success = true;
+    for (int row = 0; row < DS2431_ROWS; row++) {
+        if (!(cache->dirty & (1u << row))) {
+            continue;
+        }
+        uint16_t address = row * DS2431_ROW_SIZE;
+        if (ds2431_write_row(cache->ow, &cache->romcode, address, &cache->memory[address], DS2431_ROW_SIZE)) {
+            cache->dirty &= ~(1u << row);
+        } else {
+            success = false;
+        }
+    }
+    return success;
+}
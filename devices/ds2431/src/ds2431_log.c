@@ -0,0 +1,272 @@
+#include "ds2431_log.h"
+
+/**
+ * @brief Rows taken by a record with a data length.
+ */
+static uint8_t ds2431_log_rows(size_t len) {
+    return (len + DS2431_LOG_OVERHEAD + DS2431_ROW_SIZE - 1) / DS2431_ROW_SIZE;
+}
+
+/**
+ * @brief Copy bytes of the memory image from a row onwards, wrapping from the last row to the first.
+ */
+static void ds2431_log_copy(const ds2431_log *log, uint8_t row, size_t offset, uint8_t *buffer, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        buffer[i] = log->memory[(row * DS2431_ROW_SIZE + offset + i) % DS2431_SIZE];
+    }
+}
+
+/**
+ * @brief Parse the record starting at a row of the memory image. Returns a boolean indicating a valid record.
+ */
+static bool ds2431_log_parse(const ds2431_log *log, uint8_t row, ds2431_log_entry *entry, uint8_t *seq) {
+    uint8_t record[DS2431_LOG_MAX_ROWS * DS2431_ROW_SIZE];
+    ds2431_log_copy(log, row, 0, record, DS2431_LOG_HEADER_SIZE);
+    uint8_t len = record[2];
+    if (len > DS2431_LOG_MAX_DATA) {
+        return false;
+    }
+    ds2431_log_copy(log, row, 0, record, DS2431_LOG_OVERHEAD + len);
+
+    // The CRC is stored inverted so that erased (all zero) rows are not valid records.
+    uint8_t inverted_crc = (uint8_t)~ow_crc_8(record, DS2431_LOG_HEADER_SIZE + len);
+    if (inverted_crc != record[DS2431_LOG_HEADER_SIZE + len]) {
+        return false;
+    }
+    *entry = (ds2431_log_entry){row, ds2431_log_rows(len), record[1], len};
+    *seq = record[0];
+    return true;
+}
+
+bool ds2431_log_mount(ds2431_log *log, OW *ow, uint64_t *romcode) {
+    log->ow = ow;
+    log->romcode = *romcode;
+    log->count = 0;
+    log->head = 0;
+    log->seq = 0;
+    if (!ds2431_read(ow, romcode, DS2431_START, log->memory, DS2431_SIZE)) {
+        return false;
+    }
+
+    // Parse a record at every row.
+    ds2431_log_entry found[DS2431_ROWS];
+    uint8_t seqs[DS2431_ROWS];
+    bool valid[DS2431_ROWS];
+    int newest = -1;
+    for (int row = 0; row < DS2431_ROWS; row++) {
+        valid[row] = ds2431_log_parse(log, row, &found[row], &seqs[row]);
+        if (valid[row] && (newest < 0 || (int8_t)(seqs[row] - seqs[newest]) > 0)) {
+            newest = row;
+        }
+    }
+    if (newest < 0) {
+        return true;
+    }
+
+    // Follow the records that end where the next one starts, with consecutive sequence numbers, back from the newest.
+    ds2431_log_entry chain[DS2431_ROWS];
+    int count = 0;
+    int used = 0;
+    int row = newest;
+    while (count < DS2431_ROWS && used + found[row].rows <= DS2431_ROWS) {
+        chain[count++] = found[row];
+        used += found[row].rows;
+        int prev = -1;
+        for (int r = 0; r < DS2431_ROWS; r++) {
+            if (valid[r] && (r + found[r].rows) % DS2431_ROWS == row && seqs[r] == (uint8_t)(seqs[row] - 1)) {
+                prev = r;
+                break;
+            }
+        }
+        if (prev < 0) {
+            break;
+        }
+        row = prev;
+    }
+    for (int i = 0; i < count; i++) {
+        log->entries[i] = chain[count - 1 - i];
+    }
+    log->count = count;
+    log->head = (newest + found[newest].rows) % DS2431_ROWS;
+    log->seq = seqs[newest] + 1;
+    return true;
+}
+
+/**
+ * @brief Check whether a record is the newest of its key.
+ */
+static bool ds2431_log_latest(const ds2431_log *log, int index) {
+    for (int i = index + 1; i < log->count; i++) {
+        if (log->entries[i].key == log->entries[index].key) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check whether a record must be kept when the log wraps.
+ */
+static bool ds2431_log_kept(const ds2431_log *log, int index) {
+    const ds2431_log_entry *entry = &log->entries[index];
+    return entry->key != DS2431_LOG_EVENT && entry->len != 0 && ds2431_log_latest(log, index);
+}
+
+/**
+ * @brief Rows used by the records of the log.
+ */
+static int ds2431_log_used(const ds2431_log *log) {
+    int used = 0;
+    for (int i = 0; i < log->count; i++) {
+        used += log->entries[i].rows;
+    }
+    return used;
+}
+
+/**
+ * @brief Rows that can be written at the head without overwriting a kept record: the free rows and those of the
+ * oldest records up to the first that is kept.
+ */
+static int ds2431_log_available(const ds2431_log *log) {
+    int available = DS2431_ROWS - ds2431_log_used(log);
+    for (int i = 0; i < log->count && !ds2431_log_kept(log, i); i++) {
+        available += log->entries[i].rows;
+    }
+    return available;
+}
+
+/**
+ * @brief Rows of the largest record kept once a record has been appended, which must stay available to move it.
+ */
+static int ds2431_log_reserve(const ds2431_log *log, uint8_t key, uint8_t len) {
+    int reserve = key != DS2431_LOG_EVENT && len != 0 ? ds2431_log_rows(len) : 0;
+    for (int i = 0; i < log->count; i++) {
+        if (ds2431_log_kept(log, i) && (key == DS2431_LOG_EVENT || log->entries[i].key != key) &&
+            log->entries[i].rows > reserve) {
+            reserve = log->entries[i].rows;
+        }
+    }
+    return reserve;
+}
+
+/**
+ * @brief Write a record at the head of the ring, dropping the oldest records it overwrites. Returns a boolean
+ * indicating success status. Without program only the records are updated (for planning an append).
+ */
+static bool ds2431_log_write(ds2431_log *log, uint8_t key, const uint8_t *data, uint8_t len, bool program) {
+    uint8_t rows = ds2431_log_rows(len);
+    int used = ds2431_log_used(log);
+    while (DS2431_ROWS - used < rows) {
+        used -= log->entries[0].rows;
+        log->count -= 1;
+        memmove(&log->entries[0], &log->entries[1], log->count * sizeof(log->entries[0]));
+    }
+
+    if (program) {
+        uint8_t record[DS2431_LOG_MAX_ROWS * DS2431_ROW_SIZE];
+        memset(record, 0xFF, sizeof(record));
+        record[0] = log->seq;
+        record[1] = key;
+        record[2] = len;
+        memcpy(&record[DS2431_LOG_HEADER_SIZE], data, len);
+        record[DS2431_LOG_HEADER_SIZE + len] = ~ow_crc_8(record, DS2431_LOG_HEADER_SIZE + len);
+
+        for (int i = 0; i < rows; i++) {
+            uint16_t address = ((log->head + i) % DS2431_ROWS) * DS2431_ROW_SIZE;
+            memcpy(&log->memory[address], &record[i * DS2431_ROW_SIZE], DS2431_ROW_SIZE);
+            if (!ds2431_write_row(log->ow, &log->romcode, address, &log->memory[address], DS2431_ROW_SIZE)) {
+                return false;
+            }
+        }
+    }
+    log->entries[log->count++] = (ds2431_log_entry){log->head, rows, key, len};
+    log->head = (log->head + rows) % DS2431_ROWS;
+    log->seq += 1;
+    return true;
+}
+
+/**
+ * @brief Write the oldest kept records again at the head until the given rows are available, every record has been
+ * moved once, or the oldest kept record is the one being replaced (key). Returns false only on a write error.
+ *
+ * @note A record is only written into available rows, and its old rows only become available once the copy is
+ * complete, so a kept record always has a valid copy on the device.
+ */
+static bool ds2431_log_make_room(ds2431_log *log, int rows, uint8_t key, bool program) {
+    for (int moves = log->count; moves > 0 && ds2431_log_available(log) < rows; moves--) {
+        int first = 0;
+        while (first < log->count && !ds2431_log_kept(log, first)) {
+            first++;
+        }
+        if (first == log->count || log->entries[first].key == key ||
+            ds2431_log_available(log) < log->entries[first].rows) {
+            return true;
+        }
+        ds2431_log_entry entry = log->entries[first];
+        uint8_t copy[DS2431_LOG_MAX_DATA];
+        ds2431_log_copy(log, entry.row, DS2431_LOG_HEADER_SIZE, copy, entry.len);
+        if (!ds2431_log_write(log, entry.key, copy, entry.len, program)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Append a record, moving kept records as needed. Returns a boolean indicating success status.
+ */
+static bool ds2431_log_add(ds2431_log *log, uint8_t key, const uint8_t *data, uint8_t len, bool program) {
+    // Make room for the record and for moving the largest kept record at a later append. The record a key replaces
+    // stays kept until the new one is written, so the room to move others may only be restored afterwards.
+    int rows = ds2431_log_rows(len);
+    int reserve = ds2431_log_reserve(log, key, len);
+    if (!ds2431_log_make_room(log, rows + reserve, key, program) || ds2431_log_available(log) < rows) {
+        return false;
+    }
+    if (!ds2431_log_write(log, key, data, len, program)) {
+        return false;
+    }
+    return ds2431_log_make_room(log, reserve, DS2431_LOG_EVENT, program) && ds2431_log_available(log) >= reserve;
+}
+
+bool ds2431_log_append(ds2431_log *log, uint8_t key, const uint8_t *data, size_t len) {
+    if (len > DS2431_LOG_MAX_DATA) {
+        return false;
+    }
+
+    // Plan the append on a copy of the records first, so that nothing is written unless it succeeds.
+    ds2431_log plan = *log;
+    if (!ds2431_log_add(&plan, key, data, len, false)) {
+        return false;
+    }
+    if (!ds2431_log_add(log, key, data, len, true)) {
+        ds2431_log_mount(log, log->ow, &log->romcode);
+        return false;
+    }
+    return true;
+}
+
+int ds2431_log_count(const ds2431_log *log) {
+    return log->count;
+}
+
+int ds2431_log_get(const ds2431_log *log, int index, uint8_t *key, uint8_t *buffer, size_t size) {
+    if (index < 0 || index >= log->count || log->entries[index].len > size) {
+        return -1;
+    }
+    const ds2431_log_entry *entry = &log->entries[index];
+    if (key != NULL) {
+        *key = entry->key;
+    }
+    ds2431_log_copy(log, entry->row, DS2431_LOG_HEADER_SIZE, buffer, entry->len);
+    return entry->len;
+}
+
+int ds2431_log_find(const ds2431_log *log, uint8_t key, uint8_t *buffer, size_t size) {
+    for (int i = log->count - 1; i >= 0; i--) {
+        if (log->entries[i].key == key) {
+            return ds2431_log_get(log, i, NULL, buffer, size);
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,152 @@
+#include "ds2431_sim.h"
+
+/**
+ * @brief Queue the inverted CRC-16 of a command, its parameters and data.
+ */
+static void ds2431_sim_transmit_crc(ds2431_sim *sim, const uint8_t *header, size_t header_len, const uint8_t *data,
+                                    size_t len) {
+    uint16_t crc = CRC_START_16;
+    for (size_t i = 0; i < header_len; i++) {
+        crc = ow_update_crc_16(crc, header[i]);
+    }
+    for (size_t i = 0; i < len; i++) {
+        crc = ow_update_crc_16(crc, data[i]);
+    }
+    crc = ~crc;
+    uint8_t inverted_crc_16[2] = {(uint8_t)crc, (uint8_t)(crc >> 8)};
+    ow_sim_transmit(&sim->dev, inverted_crc_16, sizeof(inverted_crc_16));
+}
+
+static void ds2431_sim_reset(ow_sim_device *dev) {
+    ds2431_sim *sim = (ds2431_sim *)dev;
+    sim->command = 0;
+    sim->count = 0;
+    sim->copied = false;
+}
+
+/**
+ * @brief Parameters and data of WRITE SCRATCHPAD: TA1, TA2, then up to a row of data from offset 0.
+ */
+static void ds2431_sim_write_scratchpad(ds2431_sim *sim, uint8_t byte) {
+    uint8_t count = sim->count++;
+    if (count == 0) {
+        sim->ta1 = byte & ~(DS2431_ROW_SIZE - 1);   // T2:T0 are masked; writes always start a row.
+        sim->es = DS2431_SIM_PF;
+    } else if (count == 1) {
+        sim->ta2 = byte;
+    } else if (count < 2 + DS2431_ROW_SIZE) {
+        uint8_t offset = count - 2;
+        sim->scratchpad[offset] = byte;
+        sim->es = offset == DS2431_ROW_SIZE - 1 ? offset : offset | DS2431_SIM_PF;
+        if (offset == DS2431_ROW_SIZE - 1) {
+            uint8_t header[3] = {DS2431_WRITE_SCRATCHPAD, sim->ta1, sim->ta2};
+            ds2431_sim_transmit_crc(sim, header, sizeof(header), sim->scratchpad, DS2431_ROW_SIZE);
+        }
+    }
+}
+
+/**
+ * @brief Authorization pattern of COPY SCRATCHPAD: TA1, TA2 and E/S must match a complete scratchpad.
+ */
+static void ds2431_sim_copy_scratchpad(ds2431_sim *sim, uint8_t byte) {
+    if (sim->count >= sizeof(sim->auth)) {
+        return;
+    }
+    sim->auth[sim->count++] = byte;
+    if (sim->count < sizeof(sim->auth)) {
+        return;
+    }
+    uint16_t address = (uint16_t)(sim->ta2 << 8 | sim->ta1);
+    if (sim->auth[0] != sim->ta1 || sim->auth[1] != sim->ta2 || sim->auth[2] != sim->es || sim->es != DS2431_PF_MASK ||
+        address >= DS2431_SIM_MEMORY_SIZE || sim->copies_left == 0) {
+        return;
+    }
+    if (sim->copies_left > 0) {
+        sim->copies_left--;
+    }
+    memcpy(&sim->memory[address], sim->scratchpad, DS2431_ROW_SIZE);
+    sim->es |= DS2431_SIM_AA;
+    sim->copied = true;
+    sim->busy_until_us = sim->dev.bus->now_us + sim->prog_us;
+}
+
+/**
+ * @brief Parameters of READ MEMORY: TA1 and TA2, then data to the end of the register page.
+ */
+static void ds2431_sim_read_memory(ds2431_sim *sim, uint8_t byte) {
+    uint8_t count = sim->count++;
+    if (count == 0) {
+        sim->address = byte;
+    } else if (count == 1) {
+        sim->address |= (uint16_t)byte << 8;
+        if (sim->address < DS2431_SIM_MEMORY_SIZE) {
+            uint8_t data[DS2431_SIM_MEMORY_SIZE];
+            size_t len = DS2431_SIM_MEMORY_SIZE - sim->address;
+            memcpy(data, &sim->memory[sim->address], len);
+            if (sim->corrupt_memory_reads > 0) {
+                sim->corrupt_memory_reads--;
+                data[0] ^= 1u << (sim->corrupt_memory_reads % 8);  // A different bit each read; there is no CRC.
+            }
+            ow_sim_transmit(&sim->dev, data, len);
+        }
+    }
+}
+
+static void ds2431_sim_receive(ow_sim_device *dev, uint8_t byte) {
+    ds2431_sim *sim = (ds2431_sim *)dev;
+    switch (sim->command) {
+        case 0:
+            break;
+        case DS2431_WRITE_SCRATCHPAD:
+            ds2431_sim_write_scratchpad(sim, byte);
+            return;
+        case DS2431_COPY_SCRATCHPAD:
+            ds2431_sim_copy_scratchpad(sim, byte);
+            return;
+        case DS2431_READ_MEMORY:
+            ds2431_sim_read_memory(sim, byte);
+            return;
+        default:
+            return;
+    }
+
+    sim->command = byte;
+    if (byte == DS2431_READ_SCRATCHPAD) {
+        // TA1, TA2, E/S, the scratchpad up to the ending offset, then the inverted CRC-16.
+        uint8_t header[4] = {DS2431_READ_SCRATCHPAD, sim->ta1, sim->ta2, sim->es};
+        size_t len = (sim->es & (DS2431_ROW_SIZE - 1)) + 1;
+        uint8_t data[DS2431_ROW_SIZE];
+        memcpy(data, sim->scratchpad, len);
+        if (sim->corrupt_reads > 0) {
+            sim->corrupt_reads--;
+            data[0] ^= 0x01;            // Flip a bit on the way out, as a noisy bus would; the CRC is of the real data.
+        }
+        ow_sim_transmit(dev, &header[1], 3);
+        ow_sim_transmit(dev, data, len);
+        ds2431_sim_transmit_crc(sim, header, sizeof(header), sim->scratchpad, len);
+    }
+}
+
+static uint ds2431_sim_idle_bit(ow_sim_device *dev) {
+    ds2431_sim *sim = (ds2431_sim *)dev;
+    if (!sim->copied || dev->bus->now_us < sim->busy_until_us) {
+        return 1;
+    }
+    return dev->rx_bits & 1;            // Alternating 0 and 1 (AAh) once the copy has finished.
+}
+
+static const ow_sim_device_ops ds2431_sim_ops = {
+    ds2431_sim_reset,
+    ds2431_sim_receive,
+    ds2431_sim_idle_bit,
+    NULL,
+}; /**< DS2431 function layer. */
+
+void ds2431_sim_init(ds2431_sim *sim, uint64_t romcode) {
+    memset(sim, 0, sizeof(*sim));
+    ow_sim_device_init(&sim->dev, romcode, &ds2431_sim_ops);
+    sim->dev.resumable = true;
+    memset(sim->memory, 0xff, DS2431_SIM_MEMORY_SIZE);
+    sim->prog_us = DS2431_SIM_PROG_US;
+    sim->copies_left = -1;
+}
@@ -1,9 +1,62 @@
 #include "pico/stdlib.h"
 #include "onewire.h"
+#include "ow_registry.h"
 #include "ds18b20.h"
 #include "ds2431.h"
 #include <stdio.h>
 
+/**
+ * @brief Write (optionally) and read back a test string on a DS2431 EEPROM.
+ */
+static void ds2431_demo(OW *ow, uint64_t *romcode, void *context) {
+    (void)context;
+    uint16_t address = DS2431_START;
+    bool success;
+    char write_buffer[128];
+    char str[] = "This is a test of the OneWire EEPROM on device with ROM: 0x%llx";
+    size_t len = snprintf(write_buffer, sizeof(write_buffer), str, *romcode);
+#if WRITE_DS2431
+    {
+        // Erase EEPROM.
+        success = ds2431_clear(ow, romcode);
+        if (success) {
+            printf("Successfully erased EEPROM contents!\n");
+        }
+
+        // Write to EEPROM.
+        success = ds2431_write(ow, romcode, address, write_buffer, len);
+        if (success) {
+            printf("Buffer successfully written to EEPROM!\n");
+        }
+    }
+#endif
+    {
+        // Read back from EEPROM.
+        uint8_t read_buffer[len];
+        success = ds2431_read(ow, romcode, address, read_buffer, len);
+        if (success) {
+            printf("Buffer successfully read from EEPROM!\n");
+        }
+
+        // Print EEPROM contents.
+        printf("EEPROM: ");
+        for (size_t j=0; j<len; j++) {
+            printf("%c", read_buffer[j]);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Print the last converted temperature of a DS18B20.
+ */
+static void ds18b20_print(OW *ow, uint64_t *romcode, void *context) {
+    (void)context;
+    printf("ROM: 0x%llx ", *romcode);
+    int16_t temp = ds18b20_read_temperature(ow, romcode);
+    printf("%f; ", temp / 16.0);
+}
+
 int main() {
     // Serial interface.
     stdio_init_all();
@@ -34,65 +87,28 @@ int main() {
             for (int i = 0; i < num_devices; i += 1) {
                 printf("Family: 0x%x ROM: 0x%llx\n", ow_family(&romcode[i]), romcode[i]);
             }
-            for (int i=0; i < num_devices; i++) {
-                uint8_t family = ow_family(&romcode[i]);
-                if (family == DS2431_FAMILY) {
-                    uint16_t address = DS2431_START;
-                    bool success;
-                    char write_buffer[128];
-                    char str[] = "This is a test of the OneWire EEPROM on device with ROM: 0x%llx";
-                    size_t len = snprintf(write_buffer, sizeof(write_buffer), str, romcode[i]);
-#if WRITE_DS2431
-                    {
-                        // Erase EEPROM.
-                        success = ds2431_clear(&ow, &romcode[i]);
-                        if (success) {
-                            printf("Successfully erased EEPROM contents!\n");
-                        }
 
-                        // Write to EEPROM.
-                        success = ds2431_write(&ow, &romcode[i], address, write_buffer, len);
-                        if (success) {
-                            printf("Buffer successfully written to EEPROM!\n");
-                        }
-                    }
-#endif
-                    {
-                        // Read back from EEPROM.
-                        uint8_t read_buffer[len];
-                        success = ds2431_read(&ow, &romcode[i], address, read_buffer, len);
-                        if (success) {
-                            printf("Buffer successfully read from EEPROM!\n");
-                        }
+            // Group the devices by family.
+            static ow_registry registry;
+            ow_registry_init(&registry);
+            ow_registry_set_driver(&registry, DS2431_FAMILY, ds2431_demo);
+            ow_registry_set_driver(&registry, DS18B20_FAMILY, ds18b20_print);
+            ow_registry_build(&registry, romcode, num_devices);
 
-                        // Print EEPROM contents.
-                        printf("EEPROM: ");
-                        for (int j=0; j<len; j++) {
-                            printf("%c", read_buffer[j]);
-                        }
-                        printf("\n");
-                    }
-                }
-            }
-            if (num_devices > 0) {
+            ow_registry_dispatch(&registry, &ow, DS2431_FAMILY, NULL);
+            int num_sensors;
+            ow_registry_family(&registry, DS18B20_FAMILY, &num_sensors);
+            if (num_sensors > 0) {
                 printf("Printing temperature from all DS18B20 devices on OneWire bus...\n");
                 while (true) {
                     // Start temperature conversion in parallel on all DS18B20 devices.
                     ds18b20_convert_temperature_all(&ow);
 
                     // Read the result from each DS18B20 device.
-                    for (int i = 0; i < num_devices; i += 1) {
-                        uint8_t family = ow_family(&romcode[i]);
-                        if (family == DS18B20_FAMILY) {
-                            printf("ROM: 0x%llx ", romcode[i]);
-                            int16_t temp = ds18b20_read_temperature(&ow, &romcode[i]);
-                            printf("%f; ", temp / 16.0);
-                        }
-
-                    }
+                    ow_registry_dispatch(&registry, &ow, DS18B20_FAMILY, NULL);
                     printf("\n");
                 }
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -4,84 +4,143 @@
  * Copyright (c) 2023 mjcross
  *
  * SPDX-License-Identifier: BSD-3-Clause
- *
- * For the libcrc derived functionality:
- *
- * MIT License
- *
- * Copyright (c) 1999-2016 Lammert Bies
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in all
- * copies or substantial portions of the Software.
-
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
- * SOFTWARE.
  */
 
 #ifndef _ONEWIRE_H
 #define _ONEWIRE_H
 
+#ifndef OW_HOST
+#define OW_HOST             0       /**< Build for a Linux host (simulated buses) rather than the RP2040. */
+#endif
+
+#ifndef OW_STATS
+#define OW_STATS            0       /**< Keep per-bus counters (see ow_stats). */
+#endif
+
+#ifndef OW_HIST
+#define OW_HIST             0       /**< Record latency histograms (see ow_hist.h). */
+#endif
+
+#ifndef OW_TRACE
+#define OW_TRACE            0       /**< Record bus events (see ow_trace.h). */
+#endif
+
+#if OW_HOST
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+typedef unsigned int uint;
+#else
 #include "hardware/pio.h"
-#include "hardware/clocks.h"
 #include "onewire.pio.h"
+#endif
+#include "ow_crc.h"
 
 #define OW_READ_ROM         0x33    /**< Read ROM command. */
 #define OW_MATCH_ROM        0x55    /**< Match ROM command. */
 #define OW_SKIP_ROM         0xCC    /**< Skip ROM command. */
 #define OW_ALARM_SEARCH     0xEC    /**< Alarm search command. */
 #define OW_SEARCH_ROM       0xF0    /**< Search ROM command. */
+#define OW_RESUME           0xA5    /**< Resume command (re-selects the device of the last match ROM). */
+
+#define OW_SEARCH_RETRY     3       /**< Maximum retries of a search pass that fails the ROM CRC. */
+
+#ifndef OW_SINGLE_DROP_CHECK
+#define OW_SINGLE_DROP_CHECK 64     /**< Selects of a single-drop device between checks that it is still alone. */
+#endif
+
+#define OW_ROM_OK           0       /**< ROM code found with a valid CRC. */
+#define OW_ROM_RETRIED      1       /**< ROM code found with a valid CRC after retrying the pass. */
+#define OW_ROM_CRC_ERROR    2       /**< ROM code failed the CRC on every retry. */
+
+#define OW_RESET_US         960     /**< Bus time of a reset and presence detect (see onewire.pio). */
+#define OW_SLOT_US          70      /**< Bus time of one read or write time slot (see onewire.pio). */
 
-#define	CRC_START_8	    	0x00    /**< 8-bit CRC start value. */
-#define	CRC_START_16	    0x0000  /**< 16-bit CRC start value. */
-#define	CRC_POLY_16 		0xA001  /**< 16-bit CRC polynomial value. */
-
-static bool crc_tab16_init = false; /**< Boolean to indicate if CRC table has been computed. */
-
-static uint16_t crc_tab16[256];     /**< 16-bit CRC table. */
-
-static uint8_t sht75_crc_table[] = {
-        0,   49,  98,  83,  196, 245, 166, 151, 185, 136, 219, 234, 125, 76,  31,  46,
-        67,  114, 33,  16,  135, 182, 229, 212, 250, 203, 152, 169, 62,  15,  92,  109,
-        134, 183, 228, 213, 66,  115, 32,  17,  63,  14,  93,  108, 251, 202, 153, 168,
-        197, 244, 167, 150, 1,   48,  99,  82,  124, 77,  30,  47,  184, 137, 218, 235,
-        61,  12,  95,  110, 249, 200, 155, 170, 132, 181, 230, 215, 64,  113, 34,  19,
-        126, 79,  28,  45,  186, 139, 216, 233, 199, 246, 165, 148, 3,   50,  97,  80,
-        187, 138, 217, 232, 127, 78,  29,  44,  2,   51,  96,  81,  198, 247, 164, 149,
-        248, 201, 154, 171, 60,  13,  94,  111, 65,  112, 35,  18,  133, 180, 231, 214,
-        122, 75,  24,  41,  190, 143, 220, 237, 195, 242, 161, 144, 7,   54,  101, 84,
-        57,  8,   91,  106, 253, 204, 159, 174, 128, 177, 226, 211, 68,  117, 38,  23,
-        252, 205, 158, 175, 56,  9,   90,  107, 69,  116, 39,  22,  129, 176, 227, 210,
-        191, 142, 221, 236, 123, 74,  25,  40,  6,   55,  100, 85,  194, 243, 160, 145,
-        71,  118, 37,  20,  131, 178, 225, 208, 254, 207, 156, 173, 58,  11,  88,  105,
-        4,   53,  102, 87,  192, 241, 162, 147, 189, 140, 223, 238, 121, 72,  27,  42,
-        193, 240, 163, 146, 5,   52,  103, 86,  120, 73,  26,  43,  188, 141, 222, 239,
-        130, 179, 224, 209, 70,  119, 36,  21,  59,  10,  89,  104, 255, 206, 157, 172
-}; /**< SHT75 CRC table for 8-bit CRC. */
+typedef struct OW OW;
+typedef struct ow_hist ow_hist;
+typedef struct ow_trace ow_trace;
 
 /**
- * @brief OneWire PIO configuration struct.
- * 
+ * @brief Bus timing profile of a backend, used to predict bus occupancy.
+ *
+ */
+typedef struct {
+    uint32_t reset_us;          /**< Reset and presence detect. */
+    uint32_t slot_us;           /**< One read or write time slot. */
+} ow_timing;
+
+/**
+ * @brief Per-bus counters, kept when OW_STATS is enabled.
+ *
  */
 typedef struct {
-    PIO pio;        /**< PIO instance. */
-    uint sm;        /**< State machine. */
-    uint jmp_reset; /**< Jump reset. */
-    int offset;     /**< Offset of program in memory. */
-    int gpio;       /**< Pin for OneWire interface. */
-} OW;
+    uint32_t resets;            /**< Resets issued, including search passes. */
+    uint32_t presence_failures; /**< Resets with no presence pulse. */
+    uint32_t bytes;             /**< Bytes sent or read. */
+    uint32_t bits;              /**< Time slots, including search slots. */
+    uint32_t crc8_failures;     /**< CRC-8 failures (search passes and DS18B20 scratchpads). */
+    uint32_t crc16_failures;    /**< CRC-16 failures (DS2431 scratchpad writes and reads). */
+    uint32_t verify_retries;    /**< DS2431 scratchpad verify retries. */
+    uint32_t search_passes;     /**< Search passes, including retries. */
+    uint64_t blocking_us;       /**< Time spent blocked in bus calls and sleeps. */
+} ow_stats;
+
+#if OW_STATS
+#define OW_STATS_ADD(ow, counter, n)    ((ow)->stats.counter += (n))    /**< Add to a counter. */
+#else
+#define OW_STATS_ADD(ow, counter, n)    ((void)0)                       /**< Counters compiled out. */
+#endif
 
+/**
+ * @brief OneWire hardware backend. Time slots are queued a word at a time and each word returns one result, in the
+ * manner of the PIO FIFOs, so that callers can either wait for each result or service several buses in turn.
+ *
+ */
+typedef struct {
+    void (*configure)(OW *ow, uint bits);       /**< Set the number of time slots per word (1 or 8). */
+    void (*reset)(OW *ow);                      /**< Queue a bus reset; its result is 0 if a device is present. */
+    void (*put)(OW *ow, uint32_t data);         /**< Queue a word of time slots, least significant bit first. */
+    bool (*ready)(OW *ow);                      /**< Result of the oldest queued operation is available. */
+    uint32_t (*get)(OW *ow);                    /**< Wait for the oldest result (bits sampled, right aligned). */
+    void (*sleep_us)(OW *ow, uint32_t us);      /**< Wait with the bus idle. */
+    uint64_t (*time_us)(OW *ow);                /**< Current time in microseconds. */
+} ow_backend;
+
+/**
+ * @brief OneWire configuration struct.
+ * 
+ */
+struct OW {
+    const ow_backend *backend;  /**< Hardware backend. */
+    void *bus;                  /**< Backend bus context (e.g. simulated bus). */
+    uint bits;                  /**< Time slots per FIFO word. */
+    ow_timing timing;           /**< Timing profile of the backend. */
+    uint64_t single_romcode;    /**< ROM code of the only device on the bus, valid when single_drop is set. */
+    bool single_drop;           /**< Bus was found to hold one device, so ow_select can use OW_SKIP_ROM for it. */
+    uint single_drop_selects;   /**< Selects with OW_SKIP_ROM since the single-drop bus was last checked. */
+    uint64_t resume_romcode;    /**< ROM code of the last device matched, valid when resume is set. */
+    bool resume;                /**< Last device matched can be re-selected with OW_RESUME. */
+    bool rom_phase;             /**< Next byte sent follows a reset, so it is a ROM command. */
+#if OW_STATS
+    ow_stats stats;             /**< Counters. */
+#endif
+#if OW_HIST
+    ow_hist *hist;              /**< Latency histograms, or NULL. */
+#endif
+#if OW_TRACE
+    ow_trace *trace;            /**< Event trace, or NULL. */
+#endif
+#if !OW_HOST
+    PIO pio;                    /**< PIO instance. */
+    uint sm;                    /**< State machine. */
+    uint jmp_reset;             /**< Jump reset. */
+    int offset;                 /**< Offset of program in memory. */
+    int gpio;                   /**< Pin for OneWire interface. */
+    bool reset_pending;         /**< Next RX FIFO word is a reset result. */
+#endif
+};
+
+#if !OW_HOST
 /**
  * @brief Initialise OneWire via PIO. Returns a boolean indicating success status.
  * 
@@ -93,6 +152,7 @@ typedef struct {
  * @return false 
  */
 bool ow_init(OW *ow, PIO pio, uint offset, uint gpio);
+#endif
 
 /**
  * @brief Send a byte on OneWire interface. Returns a boolean indicating success status.
@@ -110,6 +170,15 @@ void ow_send(OW *ow, uint data);
  */
 uint8_t ow_read(OW *ow);
 
+/**
+ * @brief Write a byte on OneWire interface and return the bus value sampled in each of its time slots.
+ *
+ * @param ow OneWire instance.
+ * @param data Data to send (1 bits generate read slots).
+ * @return uint8_t
+ */
+uint8_t ow_touch(OW *ow, uint8_t data);
+
 /**
  * @brief Reset OneWire interface. Returns a boolean indicating success status.
  * 
@@ -119,6 +188,35 @@ uint8_t ow_read(OW *ow);
  */
 bool ow_reset(OW *ow);
 
+/**
+ * @brief Read the ROM code of the only device on the bus with OW_READ_ROM. Returns a boolean indicating a present
+ * device and a valid CRC.
+ *
+ * @note With several devices on the bus their ROM codes collide and the CRC normally fails.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code read.
+ * @return true
+ * @return false
+ */
+bool ow_read_rom(OW *ow, uint64_t *romcode);
+
+/**
+ * @brief Discover the devices on OneWire interface and detect single-drop buses. Returns number of devices found.
+ *
+ * @note The bus is marked single-drop when OW_READ_ROM and a full ROM search agree on one device, and ow_select then
+ * addresses that device with OW_SKIP_ROM. The mark is dropped by a reset without presence, by any OW_SEARCH_ROM
+ * search that does not find that device alone, and by ow_single_drop_check, which ow_select runs every
+ * OW_SINGLE_DROP_CHECK selects, so a device added later is noticed within that many selects. Run the check (or
+ * discovery) directly after the population may have changed.
+ *
+ * @param ow OneWire instance.
+ * @param romcodes Array of ROM codes found, or NULL (which cannot tell a single-drop bus).
+ * @param maxdevs Maximum number of devices (0 means no limit; 1 cannot tell a single-drop bus).
+ * @return int
+ */
+int ow_discover(OW *ow, uint64_t *romcodes, int maxdevs);
+
 /**
  * @brief Perform ROM search on OneWire interface. Returns number of devices found.
  *
@@ -130,6 +228,63 @@ bool ow_reset(OW *ow);
  */
 int ow_romsearch(OW *ow, uint64_t *romcodes, int maxdevs, uint command);
 
+/**
+ * @brief Perform ROM search on OneWire interface with per-device status. Returns number of devices found.
+ *
+ * @note A pass that fails the ROM CRC is repeated from its branch point up to OW_SEARCH_RETRY times. ROM codes
+ * that never pass are reported with OW_ROM_CRC_ERROR when status is given, and dropped otherwise.
+ *
+ * @param ow OneWire instance.
+ * @param romcodes Array of ROM codes found.
+ * @param status Array of per-device status codes (OW_ROM_OK, OW_ROM_RETRIED or OW_ROM_CRC_ERROR), or NULL.
+ * @param maxdevs Maximum number of devices (0 means no limit).
+ * @param command OneWire search command (e.g. OW_SEARCHROM or OW_ALARM_SEARCH).
+ * @return int
+ */
+int ow_romsearch_status(OW *ow, uint64_t *romcodes, uint8_t *status, int maxdevs, uint command);
+
+/**
+ * @brief Perform ROM searches on several OneWire interfaces concurrently.
+ *
+ * @note Each bus must use its own state machine. Time slots are issued on every bus in turn as soon as the previous
+ * one completes, so the total time is close to that of the slowest bus rather than the sum of all of them.
+ *
+ * @param ows Array of OneWire instances.
+ * @param num_buses Number of OneWire instances.
+ * @param romcodes Array of per-bus arrays of ROM codes found (entries may be NULL).
+ * @param maxdevs Maximum number of devices per bus (0 means no limit).
+ * @param command OneWire search command (e.g. OW_SEARCHROM or OW_ALARM_SEARCH).
+ * @param num_found Array of per-bus device counts, as returned by ow_romsearch.
+ */
+void ow_romsearch_multi(OW *ows, int num_buses, uint64_t **romcodes, int maxdevs, uint command, int *num_found);
+
+/**
+ * @brief Verify that a device is present by following its path through a ROM search. Returns a boolean
+ * indicating presence.
+ *
+ * @note The direction of every search step is forced to the given ROM code, so the check costs one reset plus at
+ * most 64 search triplets and fails at the first bit that no device on the bus has.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @return true
+ * @return false
+ */
+bool ow_verify(OW *ow, uint64_t romcode);
+
+/**
+ * @brief Check that the device of a single-drop bus is still alone, and drop the single-drop mark if not. Returns a
+ * boolean indicating the bus is still single-drop.
+ *
+ * @note Like ow_verify this follows the path of the device through one ROM search pass; any other device on the bus
+ * answers both read slots at the first bit where its ROM code differs.
+ *
+ * @param ow OneWire instance.
+ * @return true
+ * @return false
+ */
+bool ow_single_drop_check(OW *ow);
+
 /**
  * @brief Get OneWire family byte from ROM code.
  *
@@ -141,11 +296,23 @@ int ow_romsearch(OW *ow, uint64_t *romcodes, int maxdevs, uint command);
  */
 uint8_t ow_family(const uint64_t* romcode);
 
+/**
+ * @brief Check whether a family supports OW_RESUME.
+ *
+ * @param family Family byte.
+ * @return true
+ * @return false
+ */
+bool ow_family_resume(uint8_t family);
+
 /**
  * @brief Function to select a device based on the ROM code.
  *
  * @note This function can take a NULL value for the romcode argument and will then use the OW_SKIP_ROM command.
- * Ensure that this is only used when a single device is on the bus.
+ * Ensure that this is only used when a single device is on the bus. On a bus that ow_discover found to be
+ * single-drop, the device found is also selected with OW_SKIP_ROM. A device of a family that supports it (e.g.
+ * DS2431) is re-selected with OW_RESUME until another ROM command is issued. ROM commands sent with ow_send
+ * (e.g. OW_SKIP_ROM) after ow_reset also end resuming.
  *
  * @param ow
  * @param romcode
@@ -153,130 +320,80 @@ uint8_t ow_family(const uint64_t* romcode);
 void ow_select(OW *ow, uint64_t *romcode);
 
 /**
- * @brief Initialise OneWire PIO state machine.
+ * @brief Wait with the bus idle.
  *
- * @param pio PIO instance.
- * @param sm State machine.
- * @param offset Program offset.
- * @param pin_num GPIO pin.
- * @param bits_per_word Number of bits per word.
+ * @param ow OneWire instance.
+ * @param ms Time to wait in milliseconds.
  */
-static inline void ow_sm_init(PIO pio, uint sm, uint offset, uint pin_num, uint bits_per_word) {
-    // Create a new state machine configuration.
-    pio_sm_config c = onewire_program_get_default_config(offset);
-
-    // Input Shift Register configuration settings.
-    sm_config_set_in_shift(
-            &c,
-            true,               // Shift direction: right.
-            true,               // Autopush: enabled.
-            bits_per_word   // Autopush threshold.
-    );
-
-    // Output Shift Register configuration settings.
-    sm_config_set_out_shift(
-            &c,
-            true,                  // Shift direction: right.
-            true,                   // Autopull: enabled.
-            bits_per_word       // Autopull threshold.
-    );
-
-    // Configure the input and sideset pin groups to start at `pin_num`.
-    sm_config_set_in_pins(&c, pin_num);
-    sm_config_set_sideset_pins(&c, pin_num);
-
-    // Configure the clock divider for 1 usec per instruction.
-    float div;
-    div = (float) (clock_get_hz(clk_sys) * 1e-6);
-    sm_config_set_clkdiv (&c, div);
-
-    // Apply the configuration and initialise the program counter.
-    pio_sm_init(pio, sm, offset + onewire_offset_fetch_bit, &c);
-
-    // Enable the state machine.
-    pio_sm_set_enabled(pio, sm, true);
-}
+void ow_sleep_ms(OW *ow, uint32_t ms);
 
 /**
- * @brief Function to reset the OneWire instructions.
+ * @brief Wait with the bus idle.
  *
- * @param offset Program offset.
- * @return uint
+ * @param ow OneWire instance.
+ * @param us Time to wait in microseconds.
  */
-static inline uint ow_reset_instr(uint offset) {
-    // Encode a "jmp reset_bus side 0" instruction for the state machine.
-    return pio_encode_jmp(offset + onewire_offset_reset_bus) | pio_encode_sideset (1, 0);
-}
+void ow_sleep_us(OW *ow, uint32_t us);
 
 /**
- * @brief Function to compute an 8-bit CRC value from a buffer of bytes.
+ * @brief Get the current time of the bus backend in microseconds.
  *
- * @param buffer Buffer for which to calculate CRC.
- * @param len Length of buffer.
- * @return uint8_t
+ * @param ow OneWire instance.
+ * @return uint64_t
  */
-uint8_t ow_crc_8(const uint8_t* buffer, size_t len);
+uint64_t ow_time_us(OW *ow);
 
 /**
- * @brief Function to update an 8-bit CRC value using a given byte.
+ * @brief Copy the counters of a bus (all zero when OW_STATS is disabled).
  *
- * @param crc Value of CRC.
- * @param byte Byte with which to update CRC.
- * @return uint8_t
+ * @param ow OneWire instance.
+ * @param stats Counters.
  */
-uint8_t ow_update_crc_8(uint8_t crc, uint8_t val);
+void ow_stats_snapshot(const OW *ow, ow_stats *stats);
 
 /**
- * @brief Function to calculate a 16-nit CRC value from a buffer of bytes.
+ * @brief Clear the counters of a bus.
  *
- * @param buffer Buffer for which to calculate CRC.
- * @param len Length of buffer.
- * @return uint16_t
+ * @param ow OneWire instance.
  */
-uint16_t ow_crc_16(const uint8_t *buffer, size_t len);
+void ow_stats_reset(OW *ow);
 
 /**
- * @brief Function to update a 16-bit CRC value using a given byte.
+ * @brief Predict the bus time of a reset and presence detect.
  *
- * @param crc Value of CRC.
- * @param byte Byte with which to update CRC.
- * @return uint16_t
+ * @param ow OneWire instance.
+ * @return uint32_t
  */
-uint16_t update_crc_16(uint16_t crc, uint8_t c);
+uint32_t ow_cost_reset_us(const OW *ow);
 
 /**
- * @brief Perform cyclic redundancy check (CRC). Returns boolean status of check.
+ * @brief Predict the bus time of sending or reading bytes.
  *
- * @param buffer Buffer of data to check.
- * @param len Buffer length.
- * @param inverted_crc Inverted CRC from device.
- * @return true
- * @return false
+ * @param ow OneWire instance.
+ * @param num_bytes Number of bytes.
+ * @return uint32_t
  */
-bool ow_check_crc_16(uint8_t* buffer, size_t len, const uint8_t* inverted_crc);
+uint32_t ow_cost_bytes_us(const OW *ow, uint32_t num_bytes);
 
 /**
- * @brief Function to initialise the 16-bit CRC table.
+ * @brief Predict the bus time of ow_select (not including the reset before it).
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device, or NULL for OW_SKIP_ROM (also used for the device of a single-drop bus).
+ * A device that ow_select would resume costs one byte as well.
+ * @return uint32_t
+ */
+uint32_t ow_cost_select_us(const OW *ow, const uint64_t *romcode);
+
+/**
+ * @brief Predict the bus time of a search that finds a number of devices, without retries.
+ *
+ * @note Each device takes one pass of a reset, the command byte and 64 search triplets. An empty bus costs one reset.
+ *
+ * @param ow OneWire instance.
+ * @param num_devices Number of devices found.
+ * @return uint64_t
  */
-static void ow_init_crc16_tab(void) {
-    uint16_t i;
-    uint16_t j;
-    uint16_t crc;
-    uint16_t c;
-    for (i=0; i<256; i++) {
-        crc = 0;
-        c = i;
-        for (j=0; j<8; j++) {
-            if ((crc ^ c) & 0x0001) {
-                crc = (crc >> 1) ^ CRC_POLY_16;
-            } else {
-                crc = crc >> 1;
-            }
-            c = c >> 1;
-        }
-        crc_tab16[i] = crc;
-    }
-    crc_tab16_init = true;
-}
+uint64_t ow_cost_search_us(const OW *ow, uint32_t num_devices);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,147 @@
+/**
+ * For the libcrc derived functionality:
+ *
+ * MIT License
+ *
+ * Copyright (c) 1999-2016 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _OW_CRC_H
+#define _OW_CRC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define OW_CRC_BITWISE      0       /**< CRC engine computing one bit at a time, with no tables. */
+#define OW_CRC_NIBBLE       1       /**< CRC engine using 16-entry tables, one nibble at a time. */
+#define OW_CRC_TABLE        2       /**< CRC engine using 256-entry tables, one byte at a time. */
+#define OW_CRC_SLICE4       3       /**< CRC engine using 256-entry tables, four bytes at a time for buffers. */
+
+#ifndef OW_CRC_ENGINE
+#define OW_CRC_ENGINE       OW_CRC_TABLE    /**< Selected CRC engine. */
+#endif
+
+#if OW_CRC_ENGINE == OW_CRC_BITWISE
+#define OW_CRC_TABLE_BYTES  0               /**< Flash used by the CRC tables of the selected engine. */
+#elif OW_CRC_ENGINE == OW_CRC_NIBBLE
+#define OW_CRC_TABLE_BYTES  (16 + 16*2)
+#elif OW_CRC_ENGINE == OW_CRC_TABLE
+#define OW_CRC_TABLE_BYTES  (256 + 256*2)
+#elif OW_CRC_ENGINE == OW_CRC_SLICE4
+#define OW_CRC_TABLE_BYTES  (4*256 + 4*256*2)
+#else
+#error "Unknown OW_CRC_ENGINE"
+#endif
+
+#ifndef OW_CRC_SIMD
+#define OW_CRC_SIMD         0       /**< Use the host-side carry-less multiply kernels for long buffers. */
+#endif
+#define OW_CRC_SIMD_MIN_LEN 64      /**< Shortest buffer passed to the carry-less multiply kernels. */
+
+#define	CRC_START_8	    	0x00    /**< 8-bit CRC start value. */
+#define	CRC_POLY_8 		0x8C    /**< 8-bit CRC polynomial value (reflected). */
+#define	CRC_START_16	    0x0000  /**< 16-bit CRC start value. */
+#define	CRC_POLY_16 		0xA001  /**< 16-bit CRC polynomial value. */
+
+/**
+ * @brief Function to compute an 8-bit CRC value from a buffer of bytes.
+ *
+ * @param buffer Buffer for which to calculate CRC.
+ * @param len Length of buffer.
+ * @return uint8_t
+ */
+uint8_t ow_crc_8(const uint8_t* buffer, size_t len);
+
+/**
+ * @brief Function to update an 8-bit CRC value using a given byte.
+ *
+ * @param crc Value of CRC.
+ * @param byte Byte with which to update CRC.
+ * @return uint8_t
+ */
+uint8_t ow_update_crc_8(uint8_t crc, uint8_t val);
+
+/**
+ * @brief Function to update an 8-bit CRC value using a single bit, least significant bit of each byte first.
+ *
+ * @param crc Value of CRC.
+ * @param bit Bit with which to update CRC.
+ * @return uint8_t
+ */
+static inline uint8_t ow_update_crc_8_bit(uint8_t crc, unsigned int bit) {
+    bool feedback = (crc ^ bit) & 1;
+    crc >>= 1;
+    return feedback ? (crc ^ CRC_POLY_8) : crc;
+}
+
+/**
+ * @brief Function to calculate a 16-bit CRC value from a buffer of bytes.
+ *
+ * @param buffer Buffer for which to calculate CRC.
+ * @param len Length of buffer.
+ * @return uint16_t
+ */
+uint16_t ow_crc_16(const uint8_t *buffer, size_t len);
+
+/**
+ * @brief Function to update a 16-bit CRC value using a given byte.
+ *
+ * @param crc Value of CRC.
+ * @param byte Byte with which to update CRC.
+ * @return uint16_t
+ */
+uint16_t ow_update_crc_16(uint16_t crc, uint8_t c);
+
+/**
+ * @brief Perform cyclic redundancy check (CRC). Returns boolean status of check.
+ *
+ * @param buffer Buffer of data to check.
+ * @param len Buffer length.
+ * @param inverted_crc Inverted CRC from device.
+ * @return true
+ * @return false
+ */
+bool ow_check_crc_16(uint8_t* buffer, size_t len, const uint8_t* inverted_crc);
+
+#if OW_CRC_SIMD
+/**
+ * @brief Host-side function to compute an 8-bit CRC value from a buffer of bytes using carry-less multiplication
+ * (PCLMULQDQ, or VPCLMULQDQ with AVX2 where available), falling back to the selected engine otherwise.
+ *
+ * @param buffer Buffer for which to calculate CRC.
+ * @param len Length of buffer.
+ * @return uint8_t
+ */
+uint8_t ow_crc_8_clmul(const uint8_t* buffer, size_t len);
+
+/**
+ * @brief Host-side function to compute a 16-bit CRC value from a buffer of bytes using carry-less multiplication
+ * (PCLMULQDQ, or VPCLMULQDQ with AVX2 where available), falling back to the selected engine otherwise.
+ *
+ * @param buffer Buffer for which to calculate CRC.
+ * @param len Length of buffer.
+ * @return uint16_t
+ */
+uint16_t ow_crc_16_clmul(const uint8_t *buffer, size_t len);
+#endif
+
+#endif
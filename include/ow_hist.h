@@ -0,0 +1,98 @@
+#ifndef _OW_HIST_H
+#define _OW_HIST_H
+
+#include "onewire.h"
+
+#define OW_HIST_RESET           0       /**< ow_reset. */
+#define OW_HIST_SELECT          1       /**< ow_select. */
+#define OW_HIST_READ_BYTE       2       /**< ow_read. */
+#define OW_HIST_DS18B20_READ    3       /**< Whole DS18B20 temperature or scratchpad read. */
+#define OW_HIST_DS18B20_CONVERT 4       /**< DS18B20 conversion, including polling. */
+#define OW_HIST_DS2431_WRITE    5       /**< DS2431 row write, including verify and copy. */
+#define OW_HIST_SEARCH_PASS     6       /**< One ROM search pass. */
+#define OW_HIST_OPS             7       /**< Number of operation types. */
+
+#define OW_HIST_SUB_BUCKETS     4       /**< Buckets per power of two. */
+#define OW_HIST_BUCKETS         124     /**< Buckets covering 0 us to 2^32 - 1 us. */
+
+/**
+ * @brief Latency histogram of one operation type, with buckets a quarter of a power of two wide.
+ *
+ */
+typedef struct {
+    uint32_t counts[OW_HIST_BUCKETS];   /**< Samples per bucket. */
+    uint32_t count;                     /**< Number of samples. */
+    uint32_t max_us;                    /**< Largest sample. */
+    uint64_t sum_us;                    /**< Sum of the samples. */
+} ow_hist_op;
+
+/**
+ * @brief Latency histograms of every operation type.
+ *
+ */
+struct ow_hist {
+    ow_hist_op ops[OW_HIST_OPS];        /**< Histograms by operation type (e.g. OW_HIST_RESET). */
+};
+
+#if OW_HIST
+#define OW_HIST_START(ow)       uint64_t hist_start = (ow)->hist ? ow_time_us(ow) : 0  /**< Start timing a call. */
+#define OW_HIST_END(ow, op)     ow_hist_end(ow, op, hist_start)                         /**< Record its latency. */
+#else
+#define OW_HIST_START(ow)       ((void)0)
+#define OW_HIST_END(ow, op)     ((void)0)
+#endif
+
+/**
+ * @brief Record histograms for a bus. Several buses may share them.
+ *
+ * @note Only available with OW_HIST enabled.
+ *
+ * @param ow OneWire instance.
+ * @param hist Histograms, or NULL to stop recording.
+ */
+void ow_hist_attach(OW *ow, ow_hist *hist);
+
+/**
+ * @brief Record the latency of a call started at a given time, if the bus has histograms attached.
+ *
+ * @param ow OneWire instance.
+ * @param op Operation type (e.g. OW_HIST_RESET).
+ * @param start_us Start time from ow_time_us.
+ */
+void ow_hist_end(OW *ow, uint op, uint64_t start_us);
+
+/**
+ * @brief Clear the histograms.
+ *
+ * @param hist Histograms.
+ */
+void ow_hist_init(ow_hist *hist);
+
+/**
+ * @brief Record a sample.
+ *
+ * @param hist Histograms.
+ * @param op Operation type (e.g. OW_HIST_RESET).
+ * @param us Latency in microseconds.
+ */
+void ow_hist_record(ow_hist *hist, uint op, uint32_t us);
+
+/**
+ * @brief Get a percentile of the latency of an operation type. Returns the upper bound of the bucket holding it
+ * (the largest sample for the 100th percentile), or 0 if there are no samples.
+ *
+ * @param hist Histograms.
+ * @param op Operation type (e.g. OW_HIST_RESET).
+ * @param percentile Percentile, from 0 to 100 (e.g. 99.9).
+ * @return uint32_t
+ */
+uint32_t ow_hist_percentile(const ow_hist *hist, uint op, double percentile);
+
+/**
+ * @brief Print the count, mean, p50, p90, p99, p99.9 and maximum latency of every operation type with samples.
+ *
+ * @param hist Histograms.
+ */
+void ow_hist_dump(const ow_hist *hist);
+
+#endif
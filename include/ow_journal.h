@@ -0,0 +1,97 @@
+#ifndef _OW_JOURNAL_H
+#define _OW_JOURNAL_H
+
+#include "onewire.h"
+
+#define OW_JOURNAL_MAGIC        0x4c4a574f  /**< Journal magic ("OWJL"). */
+#define OW_JOURNAL_VERSION      1           /**< Journal format version. */
+#define OW_JOURNAL_HEADER_SIZE  8           /**< Journal header: magic and version. */
+
+#define OW_JOURNAL_CONFIGURE    0x00        /**< configure, followed by the bits per word. */
+#define OW_JOURNAL_RESET        0x01        /**< reset. */
+#define OW_JOURNAL_PUT          0x02        /**< put, followed by the word (1 byte, or 4 above 8 bits per word). */
+#define OW_JOURNAL_GET          0x03        /**< get, followed by the result as for put. */
+#define OW_JOURNAL_NOT_READY    0x04        /**< ready returned false. */
+#define OW_JOURNAL_READY        0x05        /**< ready returned true. */
+#define OW_JOURNAL_SLEEP        0x06        /**< sleep_us, followed by the time as a varint. */
+#define OW_JOURNAL_TIME         0x07        /**< time_us, followed by the time since the last one as a varint. */
+#define OW_JOURNAL_PUT_BIT      0x10        /**< put of a single time slot, ORed with the bit. */
+#define OW_JOURNAL_GET_BIT      0x20        /**< get of a single time slot, ORed with the bit. */
+
+/**
+ * @brief Journal recording every backend operation of a bus and its result.
+ *
+ */
+typedef struct {
+    const ow_backend *backend;      /**< Backend being recorded. */
+    void *bus;                      /**< Bus context of the backend being recorded. */
+    uint8_t *buffer;                /**< Journal storage. */
+    size_t size;                    /**< Size of the storage. */
+    size_t len;                     /**< Bytes recorded. */
+    uint64_t time_us;               /**< Last time recorded. */
+    bool overflow;                  /**< Storage filled up and recording stopped. */
+} ow_journal;
+
+/**
+ * @brief Replay of a journal as a backend.
+ *
+ */
+typedef struct {
+    const uint8_t *data;            /**< Journal. */
+    size_t len;                     /**< Journal length. */
+    size_t pos;                     /**< Position of the next record. */
+    uint64_t time_us;               /**< Time replayed so far. */
+    bool diverged;                  /**< Calls stopped matching the journal. */
+    size_t diverged_at;             /**< Position of the first record that did not match. */
+} ow_journal_replay;
+
+/**
+ * @brief Start recording the backend operations of a bus. Returns a boolean indicating success status.
+ *
+ * @note The journal is interposed as the backend of the bus until ow_journal_stop is called.
+ *
+ * @param ow OneWire instance.
+ * @param journal Journal.
+ * @param buffer Journal storage.
+ * @param size Size of the storage.
+ * @return true
+ * @return false
+ */
+bool ow_journal_start(OW *ow, ow_journal *journal, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Stop recording and restore the backend of the bus. Returns the journal length in bytes.
+ *
+ * @param ow OneWire instance.
+ * @param journal Journal.
+ * @return size_t
+ */
+size_t ow_journal_stop(OW *ow, ow_journal *journal);
+
+/**
+ * @brief Initialise OneWire on a replay of a journal. Returns a boolean indicating a valid journal header.
+ *
+ * @note Results, presence and time come from the journal. Words put, sleeps and the order of operations are
+ * checked against it, and the replay diverges at the first mismatch; from then on, gets return all ones and
+ * resets find no device.
+ *
+ * @param ow OneWire instance.
+ * @param replay Replay.
+ * @param data Journal.
+ * @param len Journal length.
+ * @return true
+ * @return false
+ */
+bool ow_journal_replay_init(OW *ow, ow_journal_replay *replay, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check that a replay consumed the whole journal without diverging. Returns a boolean indicating success
+ * status.
+ *
+ * @param replay Replay.
+ * @return true
+ * @return false
+ */
+bool ow_journal_replay_done(const ow_journal_replay *replay);
+
+#endif
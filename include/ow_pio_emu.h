@@ -0,0 +1,135 @@
+#ifndef _OW_PIO_EMU_H
+#define _OW_PIO_EMU_H
+
+#include "onewire.h"
+#include "ow_sim.h"
+
+#define OW_PIO_EMU_MAX_INSTR    32          /**< PIO instruction memory size. */
+#define OW_PIO_EMU_FIFO_DEPTH   4           /**< PIO FIFO depth. */
+#define OW_PIO_EMU_SYS_HZ       125000000   /**< Default system clock frequency. */
+#define OW_PIO_EMU_RISE_NS      1000        /**< Default pull-up rise time to the logic 1 threshold. */
+
+/**
+ * @brief Assembled PIO program.
+ *
+ */
+typedef struct {
+    uint16_t instructions[OW_PIO_EMU_MAX_INSTR];    /**< Encoded instructions. */
+    uint length;                                    /**< Number of instructions. */
+    uint wrap_target;                               /**< Wrap target (.wrap_target). */
+    uint wrap;                                      /**< Wrap source (.wrap). */
+    uint sideset_bits;                              /**< Side-set bits, including the enable bit if optional. */
+    bool sideset_opt;                               /**< Side-set is optional. */
+    bool sideset_pindirs;                           /**< Side-set drives pin directions. */
+    int offset_reset_bus;                           /**< Offset of the reset_bus label, or -1. */
+    int offset_fetch_bit;                           /**< Offset of the fetch_bit label, or -1. */
+} ow_pio_program;
+
+/**
+ * @brief Slave timing used to turn slot-level simulated devices into bus waveforms.
+ *
+ */
+typedef struct {
+    uint32_t rise_ns;           /**< Pull-up rise time from release to logic 1. */
+    uint32_t sample_us;         /**< Device sample point after a falling edge. */
+    uint32_t drive_us;          /**< Time a device holds the bus low to send a 0. */
+    uint32_t reset_min_us;      /**< Shortest low pulse a device treats as a reset. */
+    uint32_t presence_wait_us;  /**< Delay from the end of a reset to the presence pulse. */
+    uint32_t presence_us;       /**< Length of the presence pulse. */
+} ow_pio_emu_timing;
+
+/**
+ * @brief Emulated PIO state machine driving a simulated open-drain bus.
+ *
+ */
+typedef struct {
+    ow_pio_program program;         /**< Loaded program. */
+    ow_sim_bus *bus;                /**< Simulated devices. */
+    ow_pio_emu_timing timing;       /**< Slave and line timing. */
+    uint32_t sys_hz;                /**< System clock frequency. */
+    uint32_t clkdiv;                /**< Clock divider in 1/256ths (16.8 fixed point). */
+    uint32_t clkdiv_acc;            /**< Fractional divider accumulator. */
+    uint64_t sys_cycles;            /**< System clock cycles elapsed. */
+
+    // State machine.
+    uint pc;                        /**< Program counter. */
+    uint32_t x;                     /**< Scratch register X. */
+    uint32_t y;                     /**< Scratch register Y. */
+    uint32_t isr;                   /**< Input shift register. */
+    uint32_t osr;                   /**< Output shift register. */
+    uint isr_count;                 /**< Input shift count. */
+    uint osr_count;                 /**< Output shift count. */
+    uint threshold;                 /**< Autopush and autopull threshold. */
+    uint delay;                     /**< Delay cycles remaining. */
+    bool stalled;                   /**< Current instruction is stalled. */
+    bool exec_pending;              /**< An instruction has been forced with exec. */
+    uint16_t exec_instr;            /**< Forced instruction. */
+    bool pindir;                    /**< Pin direction (true drives the bus low). */
+    uint32_t tx[OW_PIO_EMU_FIFO_DEPTH];    /**< TX FIFO. */
+    uint32_t rx[OW_PIO_EMU_FIFO_DEPTH];    /**< RX FIFO. */
+    uint tx_len;                    /**< TX FIFO level. */
+    uint rx_len;                    /**< RX FIFO level. */
+    bool reset_pending;             /**< Next RX word is a presence result. */
+
+    // Line and devices.
+    uint64_t fall_ns;               /**< Time of the last falling edge driven by the master. */
+    uint64_t release_ns;            /**< Time the bus was last released by every driver. */
+    uint64_t device_low_until_ns;   /**< Devices hold the bus low until this time. */
+    uint64_t sample_at_ns;          /**< Pending device sample point, or 0. */
+    uint64_t presence_ns;           /**< Start of a pending presence pulse, or 0. */
+    bool master_low;                /**< Master drive seen by the line model. */
+    bool line_low;                  /**< Bus is being driven low. */
+
+    // Measurements.
+    uint64_t busy_cycles;           /**< State machine cycles not stalled on a FIFO. */
+    uint64_t low_ns;                /**< Total time the bus was driven low. */
+    uint64_t last_reset_low_ns;     /**< Length of the last reset pulse. */
+    uint64_t last_slot_ns;          /**< Time between the last two slot falling edges. */
+    uint64_t last_sample_ns;        /**< Time from the last falling edge to the master sample point. */
+} ow_pio_emu;
+
+/**
+ * @brief Assemble a PIO program (the subset of pioasm used by onewire.pio). Returns a boolean indicating success
+ * status.
+ *
+ * @param program Assembled program.
+ * @param path Path of the .pio source file.
+ * @return true
+ * @return false
+ */
+bool ow_pio_assemble(ow_pio_program *program, const char *path);
+
+/**
+ * @brief Initialise an emulator with default timing, a 125 MHz system clock and the 1 us instruction clock set by
+ * the PIO backend.
+ *
+ * @param emu Emulator.
+ * @param program Assembled program.
+ * @param bus Simulated devices.
+ */
+void ow_pio_emu_init(ow_pio_emu *emu, const ow_pio_program *program, ow_sim_bus *bus);
+
+/**
+ * @brief Run the emulator for one state machine clock cycle.
+ *
+ * @param emu Emulator.
+ */
+void ow_pio_emu_step(ow_pio_emu *emu);
+
+/**
+ * @brief Get the emulated time in nanoseconds.
+ *
+ * @param emu Emulator.
+ * @return uint64_t
+ */
+uint64_t ow_pio_emu_time_ns(const ow_pio_emu *emu);
+
+/**
+ * @brief Initialise OneWire on an emulated PIO state machine.
+ *
+ * @param ow OneWire instance.
+ * @param emu Emulator.
+ */
+void ow_pio_emu_attach(OW *ow, ow_pio_emu *emu);
+
+#endif
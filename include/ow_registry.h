@@ -0,0 +1,134 @@
+#ifndef _OW_REGISTRY_H
+#define _OW_REGISTRY_H
+
+#include "onewire.h"
+
+#ifndef OW_REGISTRY_MAX_DEVICES
+#define OW_REGISTRY_MAX_DEVICES     64      /**< Maximum number of devices in a registry (at most 65535). */
+#endif
+
+#ifndef OW_REGISTRY_MAX_FAMILIES
+#define OW_REGISTRY_MAX_FAMILIES    8       /**< Maximum number of distinct families in a registry (at most 254). */
+#endif
+
+#define OW_REGISTRY_NONE            0xFF    /**< Family index value for families not present. */
+
+#if OW_REGISTRY_MAX_DEVICES > 0xFFFF
+#error "OW_REGISTRY_MAX_DEVICES must be at most 65535"
+#endif
+#if OW_REGISTRY_MAX_FAMILIES >= OW_REGISTRY_NONE
+#error "OW_REGISTRY_MAX_FAMILIES must be at most 254"
+#endif
+
+/**
+ * @brief Device driver handler, called once per device of the family it is registered for.
+ *
+ * @param ow OneWire instance.
+ * @param romcode ROM code of target device.
+ * @param context User context passed to the dispatch call.
+ */
+typedef void (*ow_driver)(OW *ow, uint64_t *romcode, void *context);
+
+/**
+ * @brief Contiguous slice of registry devices sharing a family byte.
+ *
+ */
+typedef struct {
+    uint8_t family;     /**< Family byte. */
+    uint16_t start;     /**< Index of the first device in the slice. */
+    uint16_t count;     /**< Number of devices in the slice. */
+    ow_driver driver;   /**< Driver handler for the family, or NULL. */
+} ow_family_slice;
+
+/**
+ * @brief Registry of discovered devices grouped by family.
+ *
+ * @note The registry is a fixed-size struct: define OW_REGISTRY_MAX_DEVICES and OW_REGISTRY_MAX_FAMILIES for the
+ * library and the application alike to size it for larger buses. The driver table starts empty, as the device
+ * libraries are built on top of this one; register a handler per family (e.g. one calling the ds18b20_* or ds2431_*
+ * functions) with ow_registry_set_driver.
+ *
+ */
+typedef struct {
+    uint64_t romcodes[OW_REGISTRY_MAX_DEVICES];         /**< ROM codes grouped by family and sorted within each. */
+    ow_family_slice families[OW_REGISTRY_MAX_FAMILIES]; /**< Family slices. */
+    uint8_t index[256];                                 /**< Slice index by family byte, or OW_REGISTRY_NONE. */
+    uint8_t num_families;                               /**< Number of family slices. */
+    uint16_t num_devices;                               /**< Number of devices. */
+} ow_registry;
+
+/**
+ * @brief Initialise an empty registry.
+ *
+ * @param reg Registry.
+ */
+void ow_registry_init(ow_registry *reg);
+
+/**
+ * @brief Register a driver handler for a family. Returns a boolean indicating success status.
+ *
+ * @note Drivers are kept when the registry is rebuilt, so they can be registered once before discovery.
+ *
+ * @param reg Registry.
+ * @param family Family byte.
+ * @param driver Driver handler.
+ * @return true
+ * @return false
+ */
+bool ow_registry_set_driver(ow_registry *reg, uint8_t family, ow_driver driver);
+
+/**
+ * @brief Rebuild the registry from an array of ROM codes (e.g. from ow_romsearch). Returns a boolean indicating
+ * success status.
+ *
+ * @note On failure (too many devices or families) the registry is left as it was.
+ *
+ * @param reg Registry.
+ * @param romcodes Array of ROM codes.
+ * @param num_devices Number of ROM codes.
+ * @return true
+ * @return false
+ */
+bool ow_registry_build(ow_registry *reg, const uint64_t *romcodes, int num_devices);
+
+/**
+ * @brief Get the devices of a family as a contiguous array. Returns NULL if none are present.
+ *
+ * @param reg Registry.
+ * @param family Family byte.
+ * @param count Number of devices in the returned array.
+ * @return uint64_t*
+ */
+uint64_t *ow_registry_family(ow_registry *reg, uint8_t family, int *count);
+
+/**
+ * @brief Find a device by ROM code. Returns its index in the registry, or -1 if not present.
+ *
+ * @param reg Registry.
+ * @param romcode ROM code of target device.
+ * @return int
+ */
+int ow_registry_find(const ow_registry *reg, uint64_t romcode);
+
+/**
+ * @brief Call the family driver for every device of a family. Returns the number of devices dispatched.
+ *
+ * @param reg Registry.
+ * @param ow OneWire instance.
+ * @param family Family byte.
+ * @param context User context passed to the driver.
+ * @return int
+ */
+int ow_registry_dispatch(ow_registry *reg, OW *ow, uint8_t family, void *context);
+
+/**
+ * @brief Call the family driver for every device that has one. Returns the number of devices dispatched.
+ *
+ * @param reg Registry.
+ * @param ow OneWire instance.
+ * @param context User context passed to the drivers.
+ * @return int
+ */
+int ow_registry_dispatch_all(ow_registry *reg, OW *ow, void *context);
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef _OW_SIM_H
+#define _OW_SIM_H
+
+#include "onewire.h"
+
+#define OW_SIM_FIFO_DEPTH   4       /**< Depth of the simulated RX FIFO. */
+#define OW_SIM_TX_SIZE      160     /**< Maximum number of bytes a device can queue for transmission. */
+
+typedef struct ow_sim_bus ow_sim_bus;
+typedef struct ow_sim_device ow_sim_device;
+
+/**
+ * @brief Function layer of a simulated device, called once the ROM layer has selected it.
+ *
+ */
+typedef struct {
+    void (*reset)(ow_sim_device *dev);                  /**< Bus reset (optional). */
+    void (*receive)(ow_sim_device *dev, uint8_t byte);  /**< Byte received from the master (optional). */
+    uint (*idle_bit)(ow_sim_device *dev);               /**< Bit returned by read slots with nothing queued (optional, 1). */
+    bool (*alarm)(ow_sim_device *dev);                  /**< Device takes part in an alarm search (optional, false). */
+} ow_sim_device_ops;
+
+/**
+ * @brief Simulated device. Device models embed this as their first member.
+ *
+ */
+struct ow_sim_device {
+    uint64_t romcode;                   /**< ROM code. */
+    const ow_sim_device_ops *ops;       /**< Function layer, or NULL for a ROM-only device. */
+    ow_sim_bus *bus;                    /**< Bus the device is attached to. */
+    uint8_t state;                      /**< ROM layer state. */
+    uint8_t rx_byte;                    /**< Byte being received. */
+    uint8_t rx_bits;                    /**< Bits of the byte received so far. */
+    uint8_t bit;                        /**< ROM bit index for MATCH ROM and search. */
+    uint8_t phase;                      /**< Search triplet phase. */
+    bool resumable;                     /**< Device supports OW_RESUME. */
+    bool resume;                        /**< Selected by the last match ROM, so OW_RESUME selects it again. */
+    uint64_t search_romcode;            /**< ROM code answered in the current search pass. */
+    uint8_t corrupt_searches;           /**< Search passes that reach the CRC byte still to answer with a bad one (fault injection). */
+    uint8_t tx[OW_SIM_TX_SIZE];         /**< Bytes queued for transmission. */
+    uint16_t tx_len;                    /**< Number of bytes queued. */
+    uint16_t tx_pos;                    /**< Bit position of the next bit to transmit. */
+};
+
+/**
+ * @brief Simulated bus with time accounting.
+ *
+ */
+struct ow_sim_bus {
+    ow_sim_device **devices;            /**< Attached devices. */
+    ow_sim_device **active;             /**< Devices still taking part since the last reset. */
+    int num_devices;                    /**< Number of attached devices. */
+    int num_active;                     /**< Number of active devices. */
+    int capacity;                       /**< Allocated device slots. */
+    uint64_t now_us;                    /**< Simulated time in microseconds. */
+    uint32_t fifo[OW_SIM_FIFO_DEPTH];   /**< Results waiting to be read. */
+    int fifo_len;                       /**< Number of results waiting. */
+    uint64_t resets;                    /**< Number of resets issued. */
+    uint64_t slots;                     /**< Number of time slots issued. */
+    uint64_t fifo_ops;                  /**< Number of FIFO words put and got. */
+};
+
+/**
+ * @brief Initialise an empty simulated bus.
+ *
+ * @param bus Simulated bus.
+ */
+void ow_sim_bus_init(ow_sim_bus *bus);
+
+/**
+ * @brief Free the device lists of a simulated bus. The devices themselves belong to the caller.
+ *
+ * @param bus Simulated bus.
+ */
+void ow_sim_bus_free(ow_sim_bus *bus);
+
+/**
+ * @brief Initialise a simulated device.
+ *
+ * @param dev Simulated device.
+ * @param romcode ROM code.
+ * @param ops Function layer, or NULL for a ROM-only device.
+ */
+void ow_sim_device_init(ow_sim_device *dev, uint64_t romcode, const ow_sim_device_ops *ops);
+
+/**
+ * @brief Attach a device to a simulated bus. Returns a boolean indicating success status.
+ *
+ * @param bus Simulated bus.
+ * @param dev Simulated device.
+ * @return true
+ * @return false
+ */
+bool ow_sim_attach(ow_sim_bus *bus, ow_sim_device *dev);
+
+/**
+ * @brief Detach a device from a simulated bus.
+ *
+ * @param bus Simulated bus.
+ * @param dev Simulated device.
+ */
+void ow_sim_detach(ow_sim_bus *bus, ow_sim_device *dev);
+
+/**
+ * @brief Queue bytes for a device to transmit in the following read slots. Returns a boolean indicating success
+ * status.
+ *
+ * @param dev Simulated device.
+ * @param data Bytes to transmit.
+ * @param len Number of bytes.
+ * @return true
+ * @return false
+ */
+bool ow_sim_transmit(ow_sim_device *dev, const uint8_t *data, size_t len);
+
+/**
+ * @brief Issue a reset on a simulated bus. Returns a boolean indicating presence. Bus time is accounted by the caller.
+ *
+ * @param bus Simulated bus.
+ * @return true
+ * @return false
+ */
+bool ow_sim_reset(ow_sim_bus *bus);
+
+/**
+ * @brief Issue one time slot on a simulated bus. Returns the bus value sampled (wired AND of master and devices).
+ * Bus time is accounted by the caller.
+ *
+ * @param bus Simulated bus.
+ * @param bit Bit written by the master (1 for a read slot).
+ * @return uint
+ */
+uint ow_sim_slot(ow_sim_bus *bus, uint bit);
+
+/**
+ * @brief Start a time slot at the falling edge. Returns the wired AND of the bits the devices drive.
+ *
+ * @param bus Simulated bus.
+ * @return uint
+ */
+uint ow_sim_slot_begin(ow_sim_bus *bus);
+
+/**
+ * @brief End a time slot, with every device sampling the bus value.
+ *
+ * @param bus Simulated bus.
+ * @param line Bus value at the device sample point.
+ */
+void ow_sim_slot_end(ow_sim_bus *bus, uint line);
+
+/**
+ * @brief Initialise OneWire on a simulated bus.
+ *
+ * @param ow OneWire instance.
+ * @param bus Simulated bus.
+ */
+void ow_sim_init(OW *ow, ow_sim_bus *bus);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef _OW_TRACE_H
+#define _OW_TRACE_H
+
+#include "onewire.h"
+
+#define OW_TRACE_RESET          0       /**< Reset; data is 1 if a presence pulse was seen. */
+#define OW_TRACE_ROM_COMMAND    1       /**< ROM command written after a reset. */
+#define OW_TRACE_ROM_BYTE       2       /**< ROM code byte written after MATCH ROM. */
+#define OW_TRACE_COMMAND        3       /**< Function command written after the device was selected. */
+#define OW_TRACE_WRITE          4       /**< Other byte written. */
+#define OW_TRACE_READ           5       /**< Byte read. */
+
+#define OW_TRACE_MAGIC          0x5254574f  /**< Dump magic ("OWTR"). */
+#define OW_TRACE_VERSION        1           /**< Dump format version. */
+#define OW_TRACE_HEADER_SIZE    16          /**< Dump header: magic, version, event count and events dropped. */
+#define OW_TRACE_EVENT_SIZE     8           /**< Dumped event: time, type, data and two reserved bytes. */
+
+/**
+ * @brief Timestamped bus event. Times are taken at the start of the operation.
+ *
+ */
+typedef struct {
+    uint32_t time_us;                   /**< Backend time in microseconds (wraps after 71 minutes). */
+    uint8_t type;                       /**< Event type (e.g. OW_TRACE_RESET). */
+    uint8_t data;                       /**< Byte written or read, or the presence result. */
+} ow_trace_event;
+
+/**
+ * @brief Ring buffer of bus events, overwriting the oldest when full.
+ *
+ */
+struct ow_trace {
+    ow_trace_event *events;             /**< Event storage. */
+    uint32_t mask;                      /**< Capacity minus one (the capacity is a power of two). */
+    uint32_t head;                      /**< Events recorded since initialisation. */
+    uint8_t phase;                      /**< Type of the next byte written (ROM command, ROM byte, command...). */
+    uint8_t rom_bytes;                  /**< ROM code bytes still to be written after MATCH ROM. */
+};
+
+#if OW_TRACE
+#define OW_TRACE_START(ow)              uint32_t trace_start = (ow)->trace ? (uint32_t)ow_time_us(ow) : 0   /**< Start time of a call. */
+#define OW_TRACE_EVENT(ow, type, data)  ((ow)->trace ? ow_trace_record(ow, type, data, trace_start) : (void)0) /**< Record an event. */
+#else
+#define OW_TRACE_START(ow)              ((void)0)
+#define OW_TRACE_EVENT(ow, type, data)  ((void)0)
+#endif
+
+/**
+ * @brief Initialise an empty trace. Returns a boolean indicating success status (the capacity must be a power of
+ * two).
+ *
+ * @param trace Trace.
+ * @param events Event storage.
+ * @param capacity Number of events the storage holds.
+ * @return true
+ * @return false
+ */
+bool ow_trace_init(ow_trace *trace, ow_trace_event *events, uint32_t capacity);
+
+/**
+ * @brief Record the events of a bus. Several buses should not share a trace.
+ *
+ * @note Only available with OW_TRACE enabled.
+ *
+ * @param ow OneWire instance.
+ * @param trace Trace, or NULL to stop recording.
+ */
+void ow_trace_attach(OW *ow, ow_trace *trace);
+
+/**
+ * @brief Record an event. Bytes written (OW_TRACE_WRITE) are classified as ROM commands, ROM code bytes or function
+ * commands from their position after the last reset.
+ *
+ * @param ow OneWire instance.
+ * @param type Event type (OW_TRACE_RESET, OW_TRACE_WRITE or OW_TRACE_READ).
+ * @param data Byte written or read, or the presence result.
+ * @param time_us Start time of the operation.
+ */
+void ow_trace_record(OW *ow, uint type, uint8_t data, uint32_t time_us);
+
+/**
+ * @brief Get the number of events held, at most the capacity.
+ *
+ * @param trace Trace.
+ * @return uint32_t
+ */
+uint32_t ow_trace_count(const ow_trace *trace);
+
+/**
+ * @brief Serialise the held events, oldest first, for transfer to a host (see tools/ow_trace_vcd.c). Returns the
+ * number of bytes written, or 0 if the buffer is too small.
+ *
+ * @note The dump is little-endian: a header of OW_TRACE_HEADER_SIZE bytes followed by OW_TRACE_EVENT_SIZE bytes per
+ * event.
+ *
+ * @param trace Trace.
+ * @param buffer Buffer of at least OW_TRACE_HEADER_SIZE + OW_TRACE_EVENT_SIZE * ow_trace_count(trace) bytes.
+ * @param size Size of the buffer.
+ * @return size_t
+ */
+size_t ow_trace_dump(const ow_trace *trace, uint8_t *buffer, size_t size);
+
+#endif
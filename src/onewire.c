@@ -1,113 +1,429 @@
-#include "hardware/gpio.h"
-#include "hardware/pio.h"
 #include "include/onewire.h"
+#include "include/ow_hist.h"
+#include "include/ow_trace.h"
 
-bool ow_init(OW *ow, PIO pio, uint offset, uint gpio) {
-    int sm = pio_claim_unused_sm(pio, false);
-    if (sm == -1) {
-        return false;
-    }
-    gpio_init(gpio);    // Enable the GPIO and clear any output value.
-    pio_gpio_init(pio, gpio);      // Set the function to PIO output.
-    ow->gpio = gpio;
-    ow->pio = pio;
-    ow->offset = offset;
-    ow->sm = (uint)sm;
-    ow->jmp_reset = ow_reset_instr(ow->offset);   // Assemble the bus reset instruction.
-    ow_sm_init(ow->pio, ow->sm, ow->offset, ow->gpio, 8); // Set 8 bits per byte.
-    return true;
-}
+#if OW_STATS
+#define OW_STATS_START(ow)      uint64_t stats_start = (ow)->backend->time_us(ow)               /**< Start timing a call. */
+#define OW_STATS_BLOCKED(ow)    ((ow)->stats.blocking_us += (ow)->backend->time_us(ow) - stats_start) /**< Add its time. */
+#else
+#define OW_STATS_START(ow)      ((void)0)
+#define OW_STATS_BLOCKED(ow)    ((void)0)
+#endif
 
 void ow_send(OW *ow, uint data) {
-    pio_sm_put_blocking(ow->pio, ow->sm, (uint32_t)data);
-    pio_sm_get_blocking(ow->pio, ow->sm);  // Discard the response.
+    OW_TRACE_START(ow);
+    OW_STATS_START(ow);
+    if (ow->rom_phase) {
+        ow->rom_phase = false;
+        if ((uint8_t)data != OW_RESUME) {
+            ow->resume = false;             // Any other ROM command clears the resume flags.
+        }
+    }
+    ow->backend->put(ow, (uint32_t)data);
+    ow->backend->get(ow);                   // Discard the response.
+    OW_STATS_ADD(ow, bytes, 1);
+    OW_STATS_ADD(ow, bits, 8);
+    OW_STATS_BLOCKED(ow);
+    OW_TRACE_EVENT(ow, OW_TRACE_WRITE, (uint8_t)data);
 }
 
 uint8_t ow_read(OW *ow) {
-    pio_sm_put_blocking(ow->pio, ow->sm, 0xff);    // Generate read slots.
-    return (uint8_t)(pio_sm_get_blocking (ow->pio, ow->sm) >> 24);  // Shift response into bits 0..7.
+    OW_TRACE_START(ow);
+    OW_HIST_START(ow);
+    OW_STATS_START(ow);
+    ow->backend->put(ow, 0xff);             // Generate read slots.
+    uint8_t data = (uint8_t)ow->backend->get(ow);
+    OW_STATS_ADD(ow, bytes, 1);
+    OW_STATS_ADD(ow, bits, 8);
+    OW_STATS_BLOCKED(ow);
+    OW_HIST_END(ow, OW_HIST_READ_BYTE);
+    OW_TRACE_EVENT(ow, OW_TRACE_READ, data);
+    return data;
+}
+
+uint8_t ow_touch(OW *ow, uint8_t data) {
+    OW_STATS_START(ow);
+    if (ow->rom_phase) {
+        ow->rom_phase = false;
+        ow->resume = false;                 // Search or raw ROM command.
+    }
+    ow->backend->put(ow, data);
+    data = (uint8_t)ow->backend->get(ow);   // Bits sampled in each slot.
+    OW_STATS_ADD(ow, bytes, 1);
+    OW_STATS_ADD(ow, bits, 8);
+    OW_STATS_BLOCKED(ow);
+    return data;
 }
 
 bool ow_reset(OW *ow) {
-    pio_sm_exec_wait_blocking(ow->pio, ow->sm, ow->jmp_reset);
-    if ((pio_sm_get_blocking(ow->pio, ow->sm) & 1) == 0) {     // Apply pin mask (see pio program).
-        return true;    // A slave pulled the bus low.
+    OW_TRACE_START(ow);
+    OW_HIST_START(ow);
+    OW_STATS_START(ow);
+    ow->backend->reset(ow);
+    bool present = ow->backend->get(ow) == 0;   // A slave pulled the bus low.
+    ow->rom_phase = present;
+    OW_STATS_ADD(ow, resets, 1);
+    OW_STATS_ADD(ow, presence_failures, !present);
+    if (!present) {
+        ow->single_drop = false;            // The device of a single-drop bus has gone.
+        ow->resume = false;
     }
-    return false;
+    OW_STATS_BLOCKED(ow);
+    OW_HIST_END(ow, OW_HIST_RESET);
+    OW_TRACE_EVENT(ow, OW_TRACE_RESET, present);
+    return present;
 }
 
-int ow_romsearch(OW *ow, uint64_t *romcodes, int maxdevs, uint command) {
-    int index;
-    uint64_t romcode = 0ull;
-    int branch_point;
-    int next_branch_point = -1;
-    int num_found = 0;
-    bool finished = false;
-
-    ow_sm_init(ow->pio, ow->sm, ow->offset, ow->gpio, 1); // Set driver to 1-bit mode.
-
-    while (finished == false && (maxdevs == 0 || num_found < maxdevs )) {
-        finished = true;
-        branch_point = next_branch_point;
-        if (ow_reset(ow) == false) {
-            // No slaves present.
-            num_found = 0;
-            finished = true;
-            break;
+/**
+ * @brief State of a ROM search on one bus, advanced one time slot at a time so that several buses can be
+ * searched concurrently.
+ */
+typedef struct {
+    OW *ow;                     /**< OneWire instance. */
+    uint64_t *romcodes;         /**< Array of ROM codes found. */
+    uint8_t *status;            /**< Array of per-device status codes, or NULL. */
+    int maxdevs;                /**< Maximum number of devices (0 means no limit). */
+    uint command;               /**< OneWire search command. */
+    uint64_t romcode;           /**< ROM code being assembled. */
+    uint64_t last_romcode;      /**< Path to the branch point, restored if the pass is retried. */
+    int branch_point;           /**< Branch point taken in this pass. */
+    int next_branch_point;      /**< Last unexplored branch point seen in this pass. */
+    int num_found;              /**< Number of devices found. */
+    int retries;                /**< Retries of the current pass. */
+    int slot;                   /**< Time slot within the pass (OW_SEARCH_SLOT_RESET, command bits, then ROM bits). */
+    uint a;                     /**< First (true) bit read for the current ROM bit. */
+    uint8_t crc;                /**< Running CRC of the ROM bits decided so far. */
+    bool finished;              /**< No unexplored branches remain after this pass. */
+    bool done;                  /**< Search complete. */
+#if OW_HIST
+    bool in_pass;               /**< A pass has been started. */
+    uint64_t pass_start_us;     /**< Start time of the current pass. */
+#endif
+} ow_search_state;
+
+#define OW_SEARCH_SLOT_RESET    -1  /**< Waiting for the presence result of the pass reset. */
+#define OW_SEARCH_SLOT_ROM      8   /**< First ROM time slot, after the 8 command bits. */
+
+static void ow_search_put(ow_search_state *s, uint data) {
+    s->ow->backend->put(s->ow, (uint32_t)data);    // FIFO is empty: every slot waits for its response.
+    OW_STATS_ADD(s->ow, bits, 1);
+}
+
+/**
+ * @brief Record the latency of the pass that has just ended, if any.
+ */
+static void ow_search_end_pass_time(ow_search_state *s) {
+#if OW_HIST
+    if (s->in_pass) {
+        ow_hist_end(s->ow, OW_HIST_SEARCH_PASS, s->pass_start_us);
+    }
+    s->in_pass = false;
+#else
+    (void)s;
+#endif
+}
+
+static void ow_search_start_pass(ow_search_state *s) {
+    ow_search_end_pass_time(s);
+    s->ow->resume = false;                  // Every search command clears the resume flags.
+#if OW_HIST
+    s->in_pass = true;
+    s->pass_start_us = s->ow->hist ? ow_time_us(s->ow) : 0;
+#endif
+    s->finished = true;
+    s->branch_point = s->next_branch_point;
+    s->last_romcode = s->romcode;
+    s->crc = CRC_START_8;
+    s->slot = OW_SEARCH_SLOT_RESET;
+    s->ow->backend->reset(s->ow);
+    OW_STATS_ADD(s->ow, resets, 1);
+    OW_STATS_ADD(s->ow, search_passes, 1);
+}
+
+static void ow_search_finish(ow_search_state *s) {
+    ow_search_end_pass_time(s);
+    // A full search that does not find the device of a single-drop bus alone means the population has changed.
+    if (s->command == OW_SEARCH_ROM &&
+        !(s->finished && s->num_found == 1 && s->romcodes != NULL && s->romcodes[0] == s->ow->single_romcode)) {
+        s->ow->single_drop = false;
+    }
+    s->ow->backend->configure(s->ow, 8);    // Restore 8-bit mode.
+    s->done = true;
+}
+
+static void ow_search_begin(ow_search_state *s, OW *ow, uint64_t *romcodes, uint8_t *status, int maxdevs,
+                            uint command) {
+    s->ow = ow;
+    s->romcodes = romcodes;
+    s->status = status;
+    s->maxdevs = maxdevs;
+    s->command = command;
+    s->romcode = 0ull;
+    s->next_branch_point = -1;
+    s->num_found = 0;
+    s->retries = 0;
+    s->done = false;
+#if OW_HIST
+    s->in_pass = false;
+#endif
+    ow->backend->configure(ow, 1);          // Set driver to 1-bit mode.
+    ow_search_start_pass(s);
+}
+
+static void ow_search_end_pass(ow_search_state *s, bool collision) {
+    bool valid = !collision && s->crc == 0 && s->romcode != 0ull;  // All zeros means the bus is held low.
+    OW_STATS_ADD(s->ow, crc8_failures, !collision && !valid);
+    if (!valid) {
+        if (s->retries < OW_SEARCH_RETRY) {
+            // Rerun the same pass from the branch point rather than restarting the search.
+            s->retries += 1;
+            s->romcode = s->last_romcode;
+            s->next_branch_point = s->branch_point;
+            ow_search_start_pass(s);
+            return;
         }
-        for (int i = 0; i < 8; i += 1) {
-            // Send search command as single bits.
-            ow_send(ow, command >> i);
+        if (collision) {
+            s->num_found = -1;              // Persistent (1, 1) response.
+            ow_search_finish(s);
+            return;
         }
-        for (index = 0; index < 64; index += 1) {
-            // Determine ROM code bits 0..63 (see ref).
-            uint a = ow_read(ow);
-            uint b = ow_read(ow);
-            if (a == 0 && b == 0) {         // (a, b) = (0, 0)
-                if (index == branch_point) {
-                    ow_send(ow, 1);
-                    romcode |= (1ull << index);
-                } else {
-                    if (index > branch_point || (romcode & (1ull << index)) == 0) {
-                        ow_send(ow, 0);
-                        finished = false;
-                        romcode &= ~(1ull << index);
-                        next_branch_point = index;
-                    } else {                // index < branch_point or romcode[index] = 1
-                        ow_send(ow, 1);
-                    }
-                }
-            } else if (a != 0 && b != 0) {  // (a, b) = (1, 1) error (e.g. device disconnected).
-                num_found = -2;             // Function will return -1.
-                finished = true;
-                break;                      // Terminate for loop.
-            } else {
-                if (a == 0) {               // (a, b) = (0, 1) or (1, 0)
-                    ow_send(ow, 0);
-                    romcode &= ~(1ull << index);
-                } else {
-                    ow_send(ow, 1);
-                    romcode |= (1ull << index);
-                }
+        // Give up on this device and carry on with the remaining branches.
+        if (s->status != NULL) {
+            if (s->romcodes != NULL) {
+                s->romcodes[s->num_found] = s->romcode;
             }
-        }                                   // End of for loop.
-        if (romcodes != NULL) {
-            // Check crc and add romcode to array if OK.
-            uint8_t crc = 0;
-            for (int i=7; i>0; i--) {
-                uint8_t byte = (uint8_t)(romcode << (8*i));
-                crc = ow_update_crc_8(crc, byte);
+            s->status[s->num_found] = OW_ROM_CRC_ERROR;
+            s->num_found += 1;
+        }
+    } else {
+        if (s->romcodes != NULL) {
+            s->romcodes[s->num_found] = s->romcode;    // Store the ROM code.
+        }
+        if (s->status != NULL) {
+            s->status[s->num_found] = (s->retries == 0) ? OW_ROM_OK : OW_ROM_RETRIED;
+        }
+        s->num_found += 1;
+    }
+    s->retries = 0;
+    if (s->finished || (s->maxdevs != 0 && s->num_found >= s->maxdevs)) {
+        ow_search_finish(s);
+    } else {
+        ow_search_start_pass(s);
+    }
+}
+
+/**
+ * @brief Consume the response to the last time slot of a search and issue the next one.
+ *
+ * @param s Search state.
+ * @param response Bit sampled in the slot, or the reset result.
+ */
+static void ow_search_step(ow_search_state *s, uint32_t response) {
+    if (s->slot == OW_SEARCH_SLOT_RESET) {
+        if (response != 0) {
+            // No slaves present.
+            OW_STATS_ADD(s->ow, presence_failures, 1);
+            s->num_found = 0;
+            ow_search_finish(s);
+            return;
+        }
+        s->slot = 0;
+        ow_search_put(s, s->command);       // Send search command as single bits.
+        return;
+    }
+    if (s->slot < OW_SEARCH_SLOT_ROM) {
+        s->slot += 1;
+        ow_search_put(s, s->slot < OW_SEARCH_SLOT_ROM ? s->command >> s->slot : 1);
+        return;
+    }
+
+    // Determine ROM code bits 0..63 (see ref) from the (a, b) read slots and the direction written.
+    int index = (s->slot - OW_SEARCH_SLOT_ROM) / 3;
+    int phase = (s->slot - OW_SEARCH_SLOT_ROM) % 3;
+    uint value = response;
+    s->slot += 1;
+    if (phase == 0) {
+        s->a = value;
+        ow_search_put(s, 1);                // Read the complement bit.
+    } else if (phase == 1) {
+        uint a = s->a;
+        uint b = value;
+        uint bit;
+        if (a == 0 && b == 0) {             // (a, b) = (0, 0)
+            if (index == s->branch_point) {
+                bit = 1;
+            } else if (index > s->branch_point || (s->romcode & (1ull << index)) == 0) {
+                bit = 0;
+                s->finished = false;
+                s->next_branch_point = index;
+            } else {                        // index < branch_point or romcode[index] = 1
+                bit = 1;
             }
-            if (crc == (uint8_t)((romcode << (8*7)))) {     // Check against crc byte.
-                romcodes[num_found] = romcode;              // Store the ROM code.
+        } else if (a != 0 && b != 0) {      // (a, b) = (1, 1) error (e.g. device disconnected).
+            if (index == 0 && s->command == OW_ALARM_SEARCH) {
+                // No device is in alarm. For a ROM search, present devices must answer, so this is a bus error.
+                ow_search_finish(s);
+                return;
             }
+            ow_search_end_pass(s, true);
+            return;
+        } else {                            // (a, b) = (0, 1) or (1, 0)
+            bit = (a == 0) ? 0 : 1;
+        }
+        if (bit) {
+            s->romcode |= (1ull << index);
+        } else {
+            s->romcode &= ~(1ull << index);
         }
-        num_found += 1;
-    }                                       // End of while loop.
-    ow_sm_init(ow->pio, ow->sm, ow->offset, ow->gpio, 8); // Restore 8-bit mode.
+        s->crc = ow_update_crc_8_bit(s->crc, bit);  // Running the crc byte through leaves zero if valid.
+        ow_search_put(s, bit);
+    } else if (index < 63) {
+        ow_search_put(s, 1);                // Read the true bit of the next ROM bit.
+    } else {
+        ow_search_end_pass(s, false);
+    }
+}
+
+bool ow_read_rom(OW *ow, uint64_t *romcode) {
+    if (!ow_reset(ow)) {
+        return false;
+    }
+    ow_send(ow, OW_READ_ROM);
+    ow->resume = false;
+    uint8_t rom[8];
+    *romcode = 0ull;
+    for (int i = 0; i < 8; i++) {
+        rom[i] = ow_read(ow);
+        *romcode |= (uint64_t)rom[i] << (8*i);
+    }
+    return ow_crc_8(rom, 8) == 0;           // Running the crc byte through leaves zero if valid.
+}
+
+int ow_discover(OW *ow, uint64_t *romcodes, int maxdevs) {
+    uint64_t romcode = 0;
+    bool single = ow_read_rom(ow, &romcode);
+
+    // A CRC can pass on colliding ROM codes by chance, so confirm with a search that finds nothing else.
+    int num_found = ow_romsearch(ow, romcodes, maxdevs, OW_SEARCH_ROM);
+    ow->single_drop = single && num_found == 1 && maxdevs != 1 && romcodes != NULL && romcodes[0] == romcode;
+    ow->single_romcode = romcode;
+    ow->single_drop_selects = 0;
     return num_found;
 }
 
+int ow_romsearch(OW *ow, uint64_t *romcodes, int maxdevs, uint command) {
+    return ow_romsearch_status(ow, romcodes, NULL, maxdevs, command);
+}
+
+int ow_romsearch_status(OW *ow, uint64_t *romcodes, uint8_t *status, int maxdevs, uint command) {
+    OW_STATS_START(ow);
+    ow_search_state s;
+    ow_search_begin(&s, ow, romcodes, status, maxdevs, command);
+    while (!s.done) {
+        ow_search_step(&s, ow->backend->get(ow));
+    }
+    OW_STATS_BLOCKED(ow);
+    return s.num_found;
+}
+
+void ow_romsearch_multi(OW *ows, int num_buses, uint64_t **romcodes, int maxdevs, uint command, int *num_found) {
+    ow_search_state s[num_buses];
+#if OW_STATS
+    uint64_t stats_start[num_buses];
+#endif
+    for (int i = 0; i < num_buses; i++) {
+#if OW_STATS
+        stats_start[i] = ows[i].backend->time_us(&ows[i]);
+#endif
+        ow_search_begin(&s[i], &ows[i], romcodes[i], NULL, maxdevs, command);
+    }
+
+    // Service whichever state machines have a response waiting so that all buses clock slots concurrently.
+    int active = num_buses;
+    while (active > 0) {
+        for (int i = 0; i < num_buses; i++) {
+            if (s[i].done || !ows[i].backend->ready(&ows[i])) {
+                continue;
+            }
+            ow_search_step(&s[i], ows[i].backend->get(&ows[i]));
+            if (s[i].done) {
+                num_found[i] = s[i].num_found;
+                OW_STATS_ADD(&ows[i], blocking_us, ows[i].backend->time_us(&ows[i]) - stats_start[i]);
+                active -= 1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Follow the path of a device through a ROM search (see ow_verify). Returns a boolean indicating presence and
+ * sets alone if no other device answered on the path.
+ */
+static bool ow_search_path(OW *ow, uint64_t romcode, bool *alone) {
+    *alone = true;
+    if (!ow_reset(ow)) {
+        return false;
+    }
+    ow_send(ow, OW_SEARCH_ROM);
+    ow->resume = false;
+
+    // Each ROM bit is a triplet of slots: read bit, read complement, write the bit. The direction is forced, so
+    // the whole 192-slot path is known up front and can be clocked out as bytes in 8-bit mode.
+    uint8_t response[24];
+    int checked = 0;
+    for (int k = 0; k < 24; k++) {
+        uint8_t data = 0;
+        for (int j = 8*k; j < 8*k + 8; j++) {
+            uint bit = (j % 3 < 2) ? 1 : (uint)((romcode >> (j / 3)) & 1);
+            data |= bit << (j % 8);
+        }
+        response[k] = ow_touch(ow, data);
+
+        // Check every triplet whose read slots have completed, failing on the first mismatch.
+        while (3*checked + 1 < 8*k + 8) {
+            int j = 3*checked;
+            uint a = (response[j / 8] >> (j % 8)) & 1;
+            uint b = (response[(j + 1) / 8] >> ((j + 1) % 8)) & 1;
+            uint bit = (romcode >> checked) & 1;
+            if ((bit && b != 0) || (!bit && a != 0)) {
+                return false;   // No device on the bus has this bit.
+            }
+            if (a == 0 && b == 0) {
+                *alone = false; // Another device has the complement of this bit.
+            }
+            checked += 1;
+        }
+    }
+    return true;
+}
+
+bool ow_verify(OW *ow, uint64_t romcode) {
+    bool alone;
+    return ow_search_path(ow, romcode, &alone);
+}
+
+bool ow_single_drop_check(OW *ow) {
+    if (ow->single_drop) {
+        bool alone;
+        ow->single_drop = ow_search_path(ow, ow->single_romcode, &alone) && alone;
+    }
+    ow->single_drop_selects = 0;
+    return ow->single_drop;
+}
+
+bool ow_family_resume(uint8_t family) {
+    switch (family) {
+        case 0x1C:      // DS28E04.
+        case 0x29:      // DS2408.
+        case 0x2D:      // DS2431.
+        case 0x3A:      // DS2413.
+        case 0x42:      // DS28EA00.
+            return true;
+        default:
+            return false;
+    }
+}
+
 uint8_t ow_family(const uint64_t* romcode) {
     int n = 0;
     uint8_t family = (*romcode << (8*n)) & 0xff;     // Get family byte from ROM code.
@@ -115,53 +431,77 @@ uint8_t ow_family(const uint64_t* romcode) {
 }
 
 void ow_select(OW* ow, uint64_t* romcode) {
-    if (romcode == NULL) {
+    OW_HIST_START(ow);
+    if (romcode != NULL && ow->single_drop && *romcode == ow->single_romcode &&
+        ++ow->single_drop_selects >= OW_SINGLE_DROP_CHECK) {
+        // Check that no device has been added since, then reset again for the caller's transaction.
+        ow_single_drop_check(ow);
+        ow_reset(ow);
+    }
+    if (romcode == NULL || (ow->single_drop && *romcode == ow->single_romcode)) {
         ow_send(ow, OW_SKIP_ROM);
+        ow->resume = false;
+    } else if (ow->resume && *romcode == ow->resume_romcode) {
+        ow_send(ow, OW_RESUME);
     } else {
         ow_send(ow, OW_MATCH_ROM);
         for (int b = 0; b < 64; b += 8) {
             ow_send(ow, *romcode >> b);
         }
+        ow->resume = ow_family_resume(ow_family(romcode));
+        ow->resume_romcode = *romcode;
     }
+    OW_HIST_END(ow, OW_HIST_SELECT);
 }
 
-uint8_t ow_crc_8(const uint8_t* buffer, size_t len) {
-    size_t a;
-    uint8_t crc;
-    const unsigned char *ptr;
-    crc = CRC_START_8;
-    ptr = buffer;
-    if ( ptr != NULL ) {
-        for (a=0; a<len; a++) {
-            crc = sht75_crc_table[(*ptr++) ^ crc];
-        }
-    }
-    return crc;
+void ow_sleep_ms(OW *ow, uint32_t ms) {
+    ow_sleep_us(ow, ms * 1000);
 }
 
-uint8_t ow_update_crc_8(uint8_t crc, uint8_t val) {
-    return sht75_crc_table[val^crc];
+void ow_sleep_us(OW *ow, uint32_t us) {
+    ow->backend->sleep_us(ow, us);
+    OW_STATS_ADD(ow, blocking_us, us);
 }
 
-uint16_t ow_crc_16(const uint8_t *buffer, size_t len) {
-    uint16_t crc;
-    const uint8_t *ptr;
-    size_t a;
-    if (!crc_tab16_init) ow_init_crc16_tab();
-    crc = CRC_START_16;
-    ptr = buffer;
-    if (ptr != NULL) for (a=0; a<len; a++) {
-            crc = (crc >> 8) ^ crc_tab16[(crc ^ (uint16_t) *ptr++) & 0x00FF];
-        }
-    return crc;
+uint64_t ow_time_us(OW *ow) {
+    return ow->backend->time_us(ow);
+}
+
+void ow_stats_snapshot(const OW *ow, ow_stats *stats) {
+#if OW_STATS
+    *stats = ow->stats;
+#else
+    (void)ow;
+    *stats = (ow_stats){0};
+#endif
+}
+
+void ow_stats_reset(OW *ow) {
+#if OW_STATS
+    ow->stats = (ow_stats){0};
+#else
+    (void)ow;
+#endif
 }
 
-uint16_t ow_update_crc_16(uint16_t crc, uint8_t c) {
-    if (!crc_tab16_init) ow_init_crc16_tab();
-    return (crc >> 8) ^ crc_tab16[(crc ^ (uint16_t) c) & 0x00FF];
+uint32_t ow_cost_reset_us(const OW *ow) {
+    return ow->timing.reset_us;
 }
 
-bool ow_check_crc_16(uint8_t* buffer, size_t len, const uint8_t* inverted_crc) {
-    uint16_t crc = ~ow_crc_16(buffer, len);
-    return (crc & 0xFF) == inverted_crc[0] && (crc >> 8) == inverted_crc[1];
-}
\ No newline at end of file
+uint32_t ow_cost_bytes_us(const OW *ow, uint32_t num_bytes) {
+    return num_bytes * 8 * ow->timing.slot_us;
+}
+
+uint32_t ow_cost_select_us(const OW *ow, const uint64_t *romcode) {
+    bool skip = romcode == NULL || (ow->single_drop && *romcode == ow->single_romcode) ||
+                (ow->resume && *romcode == ow->resume_romcode);
+    return ow_cost_bytes_us(ow, skip ? 1 : 9);                // SKIP ROM or RESUME, or MATCH ROM and the ROM code.
+}
+
+uint64_t ow_cost_search_us(const OW *ow, uint32_t num_devices) {
+    if (num_devices == 0) {
+        return ow->timing.reset_us;
+    }
+    uint64_t pass = ow->timing.reset_us + (8 + 3*64) * ow->timing.slot_us;
+    return num_devices * pass;
+}
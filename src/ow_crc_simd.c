@@ -0,0 +1,174 @@
+#include "include/ow_crc.h"
+
+/**
+ * Host-side CRC kernels using carry-less multiplication to fold 16-byte blocks of a buffer into one, which is then
+ * finished with the byte-wise update. Buffers are handled least significant bit first, so a 16-byte block loads
+ * into a register with the highest power of x in bit 0. Folding a block forward by D bytes multiplies each 64-bit
+ * half by x^(8D+64) or x^(8D) modulo the CRC polynomial. The constants below hold (x^(e-1) mod G) * x, bit
+ * reflected about bit 64, which makes up for the one-bit offset of a carry-less product of reflected operands.
+ */
+
+/**
+ * @brief Folding constants for one CRC polynomial, low qword for the high half of a block and high qword for the
+ * low half.
+ */
+typedef struct {
+    uint64_t fold_16[2];    /**< Constants to fold by 16 bytes. */
+    uint64_t fold_64[2];    /**< Constants to fold by 64 bytes. */
+    uint64_t fold_128[2];   /**< Constants to fold by 128 bytes. */
+} ow_crc_clmul_constants;
+
+static const ow_crc_clmul_constants ow_crc_8_constants = {
+        {0x9200000000000000ull, 0x8000000000000000ull},
+        {0x5400000000000000ull, 0x1000000000000000ull},
+        {0x4300000000000000ull, 0x0100000000000000ull},
+}; /**< Constants for x^8 + x^5 + x^4 + 1. */
+
+static const ow_crc_clmul_constants ow_crc_16_constants = {
+        {0xCCD0000000000000ull, 0xC100000000000000ull},
+        {0xC450000000000000ull, 0x8101000000000000ull},
+        {0xCDD1000000000000ull, 0xD000000000000000ull},
+}; /**< Constants for x^16 + x^15 + x^2 + 1. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("pclmul,sse4.1")))
+static inline __m128i ow_crc_fold_128(__m128i x, __m128i k, __m128i next) {
+    __m128i high = _mm_clmulepi64_si128(x, k, 0x00);
+    __m128i low = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+/**
+ * @brief Fold a buffer of at least 64 bytes into 16 bytes with the same CRC remainder, using 128-bit registers.
+ * Returns the number of bytes consumed.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static size_t ow_crc_fold_sse(const uint8_t *buffer, size_t len, const ow_crc_clmul_constants *c, uint8_t *out) {
+    const __m128i k64 = _mm_loadu_si128((const __m128i *) c->fold_64);
+    const __m128i k16 = _mm_loadu_si128((const __m128i *) c->fold_16);
+    __m128i x0 = _mm_loadu_si128((const __m128i *) (buffer + 0));
+    __m128i x1 = _mm_loadu_si128((const __m128i *) (buffer + 16));
+    __m128i x2 = _mm_loadu_si128((const __m128i *) (buffer + 32));
+    __m128i x3 = _mm_loadu_si128((const __m128i *) (buffer + 48));
+    size_t i = 64;
+
+    // Four independent folds per 64 bytes.
+    for (; i + 64 <= len; i += 64) {
+        x0 = ow_crc_fold_128(x0, k64, _mm_loadu_si128((const __m128i *) (buffer + i + 0)));
+        x1 = ow_crc_fold_128(x1, k64, _mm_loadu_si128((const __m128i *) (buffer + i + 16)));
+        x2 = ow_crc_fold_128(x2, k64, _mm_loadu_si128((const __m128i *) (buffer + i + 32)));
+        x3 = ow_crc_fold_128(x3, k64, _mm_loadu_si128((const __m128i *) (buffer + i + 48)));
+    }
+
+    // Combine the accumulators, then fold in any remaining whole blocks.
+    x1 = ow_crc_fold_128(x0, k16, x1);
+    x2 = ow_crc_fold_128(x1, k16, x2);
+    x3 = ow_crc_fold_128(x2, k16, x3);
+    for (; i + 16 <= len; i += 16) {
+        x3 = ow_crc_fold_128(x3, k16, _mm_loadu_si128((const __m128i *) (buffer + i)));
+    }
+    _mm_storeu_si128((__m128i *) out, x3);
+    return i;
+}
+
+__attribute__((target("vpclmulqdq,avx2")))
+static inline __m256i ow_crc_fold_256(__m256i x, __m256i k, __m256i next) {
+    __m256i high = _mm256_clmulepi64_epi128(x, k, 0x00);
+    __m256i low = _mm256_clmulepi64_epi128(x, k, 0x11);
+    return _mm256_xor_si256(_mm256_xor_si256(high, low), next);
+}
+
+/**
+ * @brief Fold a buffer of at least 128 bytes into 16 bytes with the same CRC remainder, using 256-bit registers.
+ * Returns the number of bytes consumed.
+ */
+__attribute__((target("vpclmulqdq,avx2,pclmul,sse4.1")))
+static size_t ow_crc_fold_avx2(const uint8_t *buffer, size_t len, const ow_crc_clmul_constants *c, uint8_t *out) {
+    const __m256i k128 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) c->fold_128));
+    const __m256i k64 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) c->fold_64));
+    const __m128i k16 = _mm_loadu_si128((const __m128i *) c->fold_16);
+    __m256i y0 = _mm256_loadu_si256((const __m256i *) (buffer + 0));
+    __m256i y1 = _mm256_loadu_si256((const __m256i *) (buffer + 32));
+    __m256i y2 = _mm256_loadu_si256((const __m256i *) (buffer + 64));
+    __m256i y3 = _mm256_loadu_si256((const __m256i *) (buffer + 96));
+    size_t i = 128;
+
+    // Eight independent folds per 128 bytes.
+    for (; i + 128 <= len; i += 128) {
+        y0 = ow_crc_fold_256(y0, k128, _mm256_loadu_si256((const __m256i *) (buffer + i + 0)));
+        y1 = ow_crc_fold_256(y1, k128, _mm256_loadu_si256((const __m256i *) (buffer + i + 32)));
+        y2 = ow_crc_fold_256(y2, k128, _mm256_loadu_si256((const __m256i *) (buffer + i + 64)));
+        y3 = ow_crc_fold_256(y3, k128, _mm256_loadu_si256((const __m256i *) (buffer + i + 96)));
+    }
+
+    // Fold the first 64 bytes onto the last 64, then combine the four remaining blocks.
+    y2 = ow_crc_fold_256(y0, k64, y2);
+    y3 = ow_crc_fold_256(y1, k64, y3);
+    __m128i x = _mm256_castsi256_si128(y2);
+    x = ow_crc_fold_128(x, k16, _mm256_extracti128_si256(y2, 1));
+    x = ow_crc_fold_128(x, k16, _mm256_castsi256_si128(y3));
+    x = ow_crc_fold_128(x, k16, _mm256_extracti128_si256(y3, 1));
+    for (; i + 16 <= len; i += 16) {
+        x = ow_crc_fold_128(x, k16, _mm_loadu_si128((const __m128i *) (buffer + i)));
+    }
+    _mm_storeu_si128((__m128i *) out, x);
+    return i;
+}
+
+/**
+ * @brief Fold the bulk of a buffer with the widest kernel the CPU supports. Returns the number of bytes consumed,
+ * or zero if the buffer is too short or the CPU has no carry-less multiply.
+ */
+static size_t ow_crc_fold(const uint8_t *buffer, size_t len, const ow_crc_clmul_constants *c, uint8_t *out) {
+    if (len >= 128 && __builtin_cpu_supports("vpclmulqdq") && __builtin_cpu_supports("avx2")) {
+        return ow_crc_fold_avx2(buffer, len, c, out);
+    }
+    if (len >= 64 && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+        return ow_crc_fold_sse(buffer, len, c, out);
+    }
+    return 0;
+}
+
+#else
+
+static size_t ow_crc_fold(const uint8_t *buffer, size_t len, const ow_crc_clmul_constants *c, uint8_t *out) {
+    (void)buffer;
+    (void)len;
+    (void)c;
+    (void)out;
+    return 0;   // Portable fallback: no folding, the byte-wise engine does all the work.
+}
+
+#endif
+
+uint8_t ow_crc_8_clmul(const uint8_t* buffer, size_t len) {
+    uint8_t folded[16];
+    uint8_t crc = CRC_START_8;
+    size_t done = ow_crc_fold(buffer, len, &ow_crc_8_constants, folded);
+    if (done > 0) {
+        for (int i = 0; i < 16; i++) {
+            crc = ow_update_crc_8(crc, folded[i]);
+        }
+    }
+    for (; done < len; done++) {
+        crc = ow_update_crc_8(crc, buffer[done]);
+    }
+    return crc;
+}
+
+uint16_t ow_crc_16_clmul(const uint8_t *buffer, size_t len) {
+    uint8_t folded[16];
+    uint16_t crc = CRC_START_16;
+    size_t done = ow_crc_fold(buffer, len, &ow_crc_16_constants, folded);
+    if (done > 0) {
+        for (int i = 0; i < 16; i++) {
+            crc = ow_update_crc_16(crc, folded[i]);
+        }
+    }
+    for (; done < len; done++) {
+        crc = ow_update_crc_16(crc, buffer[done]);
+    }
+    return crc;
+}
@@ -0,0 +1,103 @@
+#include "include/ow_hist.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const ow_hist_names[OW_HIST_OPS] = {
+    "reset",
+    "select",
+    "read_byte",
+    "ds18b20_read",
+    "ds18b20_convert",
+    "ds2431_write",
+    "search_pass",
+}; /**< Operation type names for dumps. */
+
+/**
+ * @brief Bucket of a sample: exact below 4 us, then four buckets per power of two.
+ */
+static uint ow_hist_bucket(uint32_t us) {
+    if (us < OW_HIST_SUB_BUCKETS) {
+        return us;
+    }
+    uint msb = 31 - (uint)__builtin_clz(us);
+    return OW_HIST_SUB_BUCKETS * (msb - 1) + ((us >> (msb - 2)) & (OW_HIST_SUB_BUCKETS - 1));
+}
+
+/**
+ * @brief Largest sample that falls in a bucket.
+ */
+static uint32_t ow_hist_upper(uint bucket) {
+    if (bucket < OW_HIST_SUB_BUCKETS) {
+        return bucket;
+    }
+    uint msb = bucket / OW_HIST_SUB_BUCKETS + 1;
+    uint64_t lower = (uint64_t)(OW_HIST_SUB_BUCKETS + bucket % OW_HIST_SUB_BUCKETS) << (msb - 2);
+    return (uint32_t)(lower + (1ull << (msb - 2)) - 1);
+}
+
+#if OW_HIST
+void ow_hist_attach(OW *ow, ow_hist *hist) {
+    ow->hist = hist;
+}
+
+void ow_hist_end(OW *ow, uint op, uint64_t start_us) {
+    if (ow->hist != NULL) {
+        uint64_t us = ow_time_us(ow) - start_us;
+        ow_hist_record(ow->hist, op, us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+    }
+}
+#endif
+
+void ow_hist_init(ow_hist *hist) {
+    memset(hist, 0, sizeof(*hist));
+}
+
+void ow_hist_record(ow_hist *hist, uint op, uint32_t us) {
+    ow_hist_op *h = &hist->ops[op];
+    h->counts[ow_hist_bucket(us)] += 1;
+    h->count += 1;
+    h->sum_us += us;
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+}
+
+uint32_t ow_hist_percentile(const ow_hist *hist, uint op, double percentile) {
+    const ow_hist_op *h = &hist->ops[op];
+    if (h->count == 0) {
+        return 0;
+    }
+
+    // Rank of the sample, rounded up, then the bucket reaching it.
+    uint64_t rank = (uint64_t)(percentile / 100.0 * h->count + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (uint b = 0; b < OW_HIST_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank) {
+            uint32_t upper = ow_hist_upper(b);
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+void ow_hist_dump(const ow_hist *hist) {
+    printf("%-16s %8s %10s %10s %10s %10s %10s %10s\n", "op", "count", "mean(us)", "p50", "p90", "p99", "p99.9",
+           "max");
+    for (uint op = 0; op < OW_HIST_OPS; op++) {
+        const ow_hist_op *h = &hist->ops[op];
+        if (h->count == 0) {
+            continue;
+        }
+        printf("%-16s %8lu %10lu %10lu %10lu %10lu %10lu %10lu\n", ow_hist_names[op], (unsigned long)h->count,
+               (unsigned long)(h->sum_us / h->count),
+               (unsigned long)ow_hist_percentile(hist, op, 50.0),
+               (unsigned long)ow_hist_percentile(hist, op, 90.0),
+               (unsigned long)ow_hist_percentile(hist, op, 99.0),
+               (unsigned long)ow_hist_percentile(hist, op, 99.9),
+               (unsigned long)h->max_us);
+    }
+}
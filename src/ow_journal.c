@@ -0,0 +1,307 @@
+#include "include/ow_journal.h"
+
+/**
+ * @brief Append bytes to the journal, stopping for good once it is full.
+ */
+static void ow_journal_write(ow_journal *journal, const uint8_t *data, size_t len) {
+    if (journal->overflow || journal->len + len > journal->size) {
+        journal->overflow = true;
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        journal->buffer[journal->len++] = data[i];
+    }
+}
+
+static void ow_journal_record(ow_journal *journal, uint8_t op, uint32_t value, uint bits) {
+    uint8_t record[5] = {op};
+    size_t len = 1;
+    if (op == OW_JOURNAL_PUT || op == OW_JOURNAL_GET) {
+        if (bits == 1) {
+            record[0] = (op == OW_JOURNAL_PUT ? OW_JOURNAL_PUT_BIT : OW_JOURNAL_GET_BIT) | (value & 1);
+        } else {
+            for (uint i = 0; i < (bits <= 8 ? 1u : 4u); i++) {
+                record[len++] = (uint8_t)(value >> (8*i));
+            }
+        }
+    }
+    ow_journal_write(journal, record, len);
+}
+
+static void ow_journal_record_varint(ow_journal *journal, uint8_t op, uint64_t value) {
+    uint8_t record[11] = {op};
+    size_t len = 1;
+    do {
+        record[len++] = (uint8_t)((value & 0x7f) | (value > 0x7f ? 0x80 : 0));
+        value >>= 7;
+    } while (value != 0);
+    ow_journal_write(journal, record, len);
+}
+
+/**
+ * @brief Run a call on the recorded backend, with its own bus context in place.
+ */
+#define OW_JOURNAL_CALL(ow, journal, call) do {     \
+        (ow)->backend = (journal)->backend;         \
+        (ow)->bus = (journal)->bus;                 \
+        call;                                       \
+        (ow)->backend = &ow_journal_backend;        \
+        (ow)->bus = (journal);                      \
+    } while (0)
+
+static const ow_backend ow_journal_backend;
+
+static void ow_journal_configure(OW *ow, uint bits) {
+    ow_journal *journal = ow->bus;
+    OW_JOURNAL_CALL(ow, journal, journal->backend->configure(ow, bits));
+    uint8_t record[2] = {OW_JOURNAL_CONFIGURE, (uint8_t)bits};
+    ow_journal_write(journal, record, sizeof(record));
+}
+
+static void ow_journal_reset(OW *ow) {
+    ow_journal *journal = ow->bus;
+    OW_JOURNAL_CALL(ow, journal, journal->backend->reset(ow));
+    ow_journal_record(journal, OW_JOURNAL_RESET, 0, 0);
+}
+
+static void ow_journal_put(OW *ow, uint32_t data) {
+    ow_journal *journal = ow->bus;
+    OW_JOURNAL_CALL(ow, journal, journal->backend->put(ow, data));
+    ow_journal_record(journal, OW_JOURNAL_PUT, data, ow->bits);
+}
+
+static bool ow_journal_ready(OW *ow) {
+    ow_journal *journal = ow->bus;
+    bool ready;
+    OW_JOURNAL_CALL(ow, journal, ready = journal->backend->ready(ow));
+    ow_journal_record(journal, ready ? OW_JOURNAL_READY : OW_JOURNAL_NOT_READY, 0, 0);
+    return ready;
+}
+
+static uint32_t ow_journal_get(OW *ow) {
+    ow_journal *journal = ow->bus;
+    uint32_t result;
+    OW_JOURNAL_CALL(ow, journal, result = journal->backend->get(ow));
+    ow_journal_record(journal, OW_JOURNAL_GET, result, ow->bits);
+    return result;
+}
+
+static void ow_journal_sleep_us(OW *ow, uint32_t us) {
+    ow_journal *journal = ow->bus;
+    OW_JOURNAL_CALL(ow, journal, journal->backend->sleep_us(ow, us));
+    ow_journal_record_varint(journal, OW_JOURNAL_SLEEP, us);
+}
+
+static uint64_t ow_journal_time_us(OW *ow) {
+    ow_journal *journal = ow->bus;
+    uint64_t time_us;
+    OW_JOURNAL_CALL(ow, journal, time_us = journal->backend->time_us(ow));
+    ow_journal_record_varint(journal, OW_JOURNAL_TIME, time_us - journal->time_us);
+    journal->time_us = time_us;
+    return time_us;
+}
+
+static const ow_backend ow_journal_backend = {
+    ow_journal_configure,
+    ow_journal_reset,
+    ow_journal_put,
+    ow_journal_ready,
+    ow_journal_get,
+    ow_journal_sleep_us,
+    ow_journal_time_us,
+}; /**< Recording backend. */
+
+bool ow_journal_start(OW *ow, ow_journal *journal, uint8_t *buffer, size_t size) {
+    if (size < OW_JOURNAL_HEADER_SIZE || ow->backend == &ow_journal_backend) {
+        return false;
+    }
+    journal->backend = ow->backend;
+    journal->bus = ow->bus;
+    journal->buffer = buffer;
+    journal->size = size;
+    journal->len = 0;
+    journal->overflow = false;
+    journal->time_us = 0;
+    uint8_t header[OW_JOURNAL_HEADER_SIZE];
+    for (int i = 0; i < 4; i++) {
+        header[i] = (uint8_t)(OW_JOURNAL_MAGIC >> (8*i));
+        header[4 + i] = (uint8_t)(OW_JOURNAL_VERSION >> (8*i));
+    }
+    ow_journal_write(journal, header, sizeof(header));
+    ow->backend = &ow_journal_backend;
+    ow->bus = journal;
+    return true;
+}
+
+size_t ow_journal_stop(OW *ow, ow_journal *journal) {
+    if (ow->backend == &ow_journal_backend) {
+        ow->backend = journal->backend;
+        ow->bus = journal->bus;
+    }
+    return journal->len;
+}
+
+/**
+ * @brief Read the next record if it has the expected operation, otherwise mark the replay as diverged. Returns a
+ * boolean indicating a match.
+ */
+static bool ow_journal_expect(ow_journal_replay *replay, uint8_t op) {
+    if (replay->diverged) {
+        return false;
+    }
+    if (replay->pos < replay->len && replay->data[replay->pos] == op) {
+        replay->pos += 1;
+        return true;
+    }
+    replay->diverged = true;
+    replay->diverged_at = replay->pos;
+    return false;
+}
+
+static uint32_t ow_journal_read_word(ow_journal_replay *replay, uint bits) {
+    uint32_t value = 0;
+    uint len = bits <= 8 ? 1 : 4;
+    for (uint i = 0; i < len && replay->pos < replay->len; i++) {
+        value |= (uint32_t)replay->data[replay->pos++] << (8*i);
+    }
+    return value;
+}
+
+static uint64_t ow_journal_read_varint(ow_journal_replay *replay) {
+    uint64_t value = 0;
+    for (uint shift = 0; replay->pos < replay->len && shift < 64; shift += 7) {
+        uint8_t byte = replay->data[replay->pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+/**
+ * @brief Mark the replay as diverged at a record that has just been read.
+ */
+static void ow_journal_diverge(ow_journal_replay *replay, size_t pos) {
+    replay->diverged = true;
+    replay->diverged_at = pos;
+}
+
+static void ow_journal_replay_configure(OW *ow, uint bits) {
+    ow_journal_replay *replay = ow->bus;
+    ow->bits = bits;
+    size_t pos = replay->pos;
+    if (ow_journal_expect(replay, OW_JOURNAL_CONFIGURE) && ow_journal_read_word(replay, 8) != bits) {
+        ow_journal_diverge(replay, pos);
+    }
+}
+
+static void ow_journal_replay_reset(OW *ow) {
+    ow_journal_expect(ow->bus, OW_JOURNAL_RESET);
+}
+
+static void ow_journal_replay_put(OW *ow, uint32_t data) {
+    ow_journal_replay *replay = ow->bus;
+    size_t pos = replay->pos;
+    if (ow->bits == 1) {
+        if (!ow_journal_expect(replay, OW_JOURNAL_PUT_BIT | (data & 1))) {
+            return;
+        }
+    } else if (ow_journal_expect(replay, OW_JOURNAL_PUT) &&
+               ow_journal_read_word(replay, ow->bits) != (ow->bits <= 8 ? data & 0xff : data)) {
+        ow_journal_diverge(replay, pos);
+    }
+}
+
+static bool ow_journal_replay_ready(OW *ow) {
+    ow_journal_replay *replay = ow->bus;
+    if (replay->diverged) {
+        return true;
+    }
+    if (replay->pos < replay->len && replay->data[replay->pos] == OW_JOURNAL_NOT_READY) {
+        replay->pos += 1;
+        return false;
+    }
+    ow_journal_expect(replay, OW_JOURNAL_READY);
+    return true;
+}
+
+static uint32_t ow_journal_replay_get(OW *ow) {
+    ow_journal_replay *replay = ow->bus;
+    if (ow->bits == 1) {
+        if (!replay->diverged && replay->pos < replay->len &&
+            (replay->data[replay->pos] & ~1u) == OW_JOURNAL_GET_BIT) {
+            return replay->data[replay->pos++] & 1;
+        }
+        ow_journal_expect(replay, OW_JOURNAL_GET_BIT);
+        return 1;
+    }
+    if (!ow_journal_expect(replay, OW_JOURNAL_GET)) {
+        return 0xffffffff >> (32 - ow->bits);
+    }
+    return ow_journal_read_word(replay, ow->bits);
+}
+
+static void ow_journal_replay_sleep_us(OW *ow, uint32_t us) {
+    ow_journal_replay *replay = ow->bus;
+    size_t pos = replay->pos;
+    if (ow_journal_expect(replay, OW_JOURNAL_SLEEP) && ow_journal_read_varint(replay) != us) {
+        ow_journal_diverge(replay, pos);
+    }
+}
+
+static uint64_t ow_journal_replay_time_us(OW *ow) {
+    ow_journal_replay *replay = ow->bus;
+    if (ow_journal_expect(replay, OW_JOURNAL_TIME)) {
+        replay->time_us += ow_journal_read_varint(replay);
+    }
+    return replay->time_us;
+}
+
+static const ow_backend ow_journal_replay_backend = {
+    ow_journal_replay_configure,
+    ow_journal_replay_reset,
+    ow_journal_replay_put,
+    ow_journal_replay_ready,
+    ow_journal_replay_get,
+    ow_journal_replay_sleep_us,
+    ow_journal_replay_time_us,
+}; /**< Replay backend. */
+
+bool ow_journal_replay_init(OW *ow, ow_journal_replay *replay, const uint8_t *data, size_t len) {
+    replay->data = data;
+    replay->len = len;
+    replay->pos = OW_JOURNAL_HEADER_SIZE;
+    replay->time_us = 0;
+    replay->diverged = false;
+    replay->diverged_at = 0;
+    ow->backend = &ow_journal_replay_backend;
+    ow->bus = replay;
+    ow->bits = 8;
+    ow->timing = (ow_timing){OW_RESET_US, OW_SLOT_US};
+    ow->single_drop = false;
+    ow->single_drop_selects = 0;
+    ow->resume = false;
+    ow->rom_phase = false;
+    ow_stats_reset(ow);
+#if OW_HIST
+    ow->hist = NULL;
+#endif
+#if OW_TRACE
+    ow->trace = NULL;
+#endif
+    if (len < OW_JOURNAL_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    for (int i = 0; i < 4; i++) {
+        magic |= (uint32_t)data[i] << (8*i);
+        version |= (uint32_t)data[4 + i] << (8*i);
+    }
+    return magic == OW_JOURNAL_MAGIC && version == OW_JOURNAL_VERSION;
+}
+
+bool ow_journal_replay_done(const ow_journal_replay *replay) {
+    return !replay->diverged && replay->pos == replay->len;
+}
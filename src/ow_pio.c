@@ -0,0 +1,139 @@
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "pico/time.h"
+#include "include/onewire.h"
+
+/**
+ * @brief Initialise OneWire PIO state machine.
+ *
+ * @param pio PIO instance.
+ * @param sm State machine.
+ * @param offset Program offset.
+ * @param pin_num GPIO pin.
+ * @param bits_per_word Number of bits per word.
+ */
+static void ow_sm_init(PIO pio, uint sm, uint offset, uint pin_num, uint bits_per_word) {
+    // Create a new state machine configuration.
+    pio_sm_config c = onewire_program_get_default_config(offset);
+
+    // Input Shift Register configuration settings.
+    sm_config_set_in_shift(
+            &c,
+            true,               // Shift direction: right.
+            true,               // Autopush: enabled.
+            bits_per_word   // Autopush threshold.
+    );
+
+    // Output Shift Register configuration settings.
+    sm_config_set_out_shift(
+            &c,
+            true,                  // Shift direction: right.
+            true,                   // Autopull: enabled.
+            bits_per_word       // Autopull threshold.
+    );
+
+    // Configure the input and sideset pin groups to start at `pin_num`.
+    sm_config_set_in_pins(&c, pin_num);
+    sm_config_set_sideset_pins(&c, pin_num);
+
+    // Configure the clock divider for 1 usec per instruction.
+    float div;
+    div = (float) (clock_get_hz(clk_sys) * 1e-6);
+    sm_config_set_clkdiv (&c, div);
+
+    // Apply the configuration and initialise the program counter.
+    pio_sm_init(pio, sm, offset + onewire_offset_fetch_bit, &c);
+
+    // Enable the state machine.
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+/**
+ * @brief Function to reset the OneWire instructions.
+ *
+ * @param offset Program offset.
+ * @return uint
+ */
+static inline uint ow_reset_instr(uint offset) {
+    // Encode a "jmp reset_bus side 0" instruction for the state machine.
+    return pio_encode_jmp(offset + onewire_offset_reset_bus) | pio_encode_sideset (1, 0);
+}
+
+static void ow_pio_configure(OW *ow, uint bits) {
+    ow->bits = bits;
+    ow_sm_init(ow->pio, ow->sm, ow->offset, ow->gpio, bits);
+}
+
+static void ow_pio_reset(OW *ow) {
+    ow->reset_pending = true;
+    pio_sm_exec_wait_blocking(ow->pio, ow->sm, ow->jmp_reset);
+}
+
+static void ow_pio_put(OW *ow, uint32_t data) {
+    pio_sm_put_blocking(ow->pio, ow->sm, data);
+}
+
+static bool ow_pio_ready(OW *ow) {
+    return !pio_sm_is_rx_fifo_empty(ow->pio, ow->sm);
+}
+
+static uint32_t ow_pio_get(OW *ow) {
+    uint32_t word = pio_sm_get_blocking(ow->pio, ow->sm);
+    if (ow->reset_pending) {
+        ow->reset_pending = false;
+        return word & 1;                    // Apply pin mask (see pio program).
+    }
+    return word >> (32 - ow->bits);         // Shift response into bits 0..bits-1.
+}
+
+static void ow_pio_sleep_us(OW *ow, uint32_t us) {
+    (void)ow;
+    sleep_us(us);
+}
+
+static uint64_t ow_pio_time_us(OW *ow) {
+    (void)ow;
+    return time_us_64();
+}
+
+static const ow_backend ow_pio_backend = {
+    ow_pio_configure,
+    ow_pio_reset,
+    ow_pio_put,
+    ow_pio_ready,
+    ow_pio_get,
+    ow_pio_sleep_us,
+    ow_pio_time_us,
+}; /**< PIO backend. */
+
+bool ow_init(OW *ow, PIO pio, uint offset, uint gpio) {
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm == -1) {
+        return false;
+    }
+    gpio_init(gpio);    // Enable the GPIO and clear any output value.
+    pio_gpio_init(pio, gpio);      // Set the function to PIO output.
+    ow->backend = &ow_pio_backend;
+    ow->bus = NULL;
+    ow->gpio = gpio;
+    ow->pio = pio;
+    ow->offset = offset;
+    ow->sm = (uint)sm;
+    ow->jmp_reset = ow_reset_instr(ow->offset);   // Assemble the bus reset instruction.
+    ow->reset_pending = false;
+    ow->timing = (ow_timing){OW_RESET_US, OW_SLOT_US};
+    ow->single_drop = false;
+    ow->single_drop_selects = 0;
+    ow->resume = false;
+    ow->rom_phase = false;
+    ow_stats_reset(ow);
+#if OW_HIST
+    ow->hist = NULL;
+#endif
+#if OW_TRACE
+    ow->trace = NULL;
+#endif
+    ow_pio_configure(ow, 8); // Set 8 bits per byte.
+    return true;
+}
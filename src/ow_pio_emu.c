@@ -0,0 +1,652 @@
+#include "include/ow_pio_emu.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OW_PIO_JMP      0   /**< JMP opcode. */
+#define OW_PIO_WAIT     1   /**< WAIT opcode. */
+#define OW_PIO_IN       2   /**< IN opcode. */
+#define OW_PIO_OUT      3   /**< OUT opcode. */
+#define OW_PIO_PUSHPULL 4   /**< PUSH and PULL opcode. */
+#define OW_PIO_MOV      5   /**< MOV opcode. */
+#define OW_PIO_IRQ      6   /**< IRQ opcode. */
+#define OW_PIO_SET      7   /**< SET opcode. */
+
+#define OW_PIO_LINE_MAX     256     /**< Longest source line. */
+#define OW_PIO_LABELS_MAX   32      /**< Most labels in a program. */
+
+/**
+ * @brief Program label found by the first assembler pass.
+ */
+typedef struct {
+    char name[32];  /**< Label name. */
+    uint address;   /**< Instruction address. */
+} ow_pio_label;
+
+/**
+ * @brief Strip comments and surrounding white space from a source line in place. Returns the trimmed line.
+ */
+static char *ow_pio_trim(char *line) {
+    char *comment = strpbrk(line, ";");
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+    comment = strstr(line, "//");
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    char *end = line + strlen(line);
+    while (end > line && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return line;
+}
+
+/**
+ * @brief Split off a leading "label:" (optionally PUBLIC). Returns the rest of the line and copies the label name, or
+ * returns the line unchanged with an empty name.
+ */
+static char *ow_pio_split_label(char *line, char *name, size_t size) {
+    name[0] = '\0';
+    char *colon = strchr(line, ':');
+    if (colon == NULL || strstr(line, "::") == colon) {
+        return line;
+    }
+    *colon = '\0';
+    char *label = line;
+    if (strncmp(label, "PUBLIC", 6) == 0 && isspace((unsigned char)label[6])) {
+        label += 7;
+    }
+    snprintf(name, size, "%s", ow_pio_trim(label));
+    return ow_pio_trim(colon + 1);
+}
+
+/**
+ * @brief Split an instruction into tokens at white space and commas. Returns the number of tokens.
+ */
+static int ow_pio_tokens(char *line, char **tokens, int max) {
+    int n = 0;
+    for (char *t = strtok(line, " \t,"); t != NULL && n < max; t = strtok(NULL, " \t,")) {
+        tokens[n++] = t;
+    }
+    return n;
+}
+
+static int ow_pio_lookup(const char *name, const char *const *names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (names[i] != NULL && strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Encode one instruction. Returns the encoding, or -1 on a syntax error.
+ */
+static int ow_pio_encode(char **t, int n, const ow_pio_program *program, const ow_pio_label *labels, int num_labels) {
+    static const char *const jmp_conditions[] = {"", "!x", "x--", "!y", "y--", "x!=y", "pin", "!osre"};
+    static const char *const in_sources[] = {"pins", "x", "y", "null", NULL, NULL, "isr", "osr"};
+    static const char *const out_destinations[] = {"pins", "x", "y", "null", "pindirs", "pc", "isr", "exec"};
+    static const char *const mov_destinations[] = {"pins", "x", "y", NULL, "exec", "pc", "isr", "osr"};
+    static const char *const mov_sources[] = {"pins", "x", "y", "null", NULL, "status", "isr", "osr"};
+    static const char *const set_destinations[] = {"pins", "x", "y", NULL, "pindirs"};
+    static const char *const wait_sources[] = {"gpio", "pin", "irq"};
+
+    // Side-set and delay.
+    int side = -1;
+    int delay = 0;
+    while (n > 1) {
+        if (t[n-1][0] == '[') {
+            delay = atoi(t[n-1] + 1);
+            n--;
+        } else if (n > 2 && strcmp(t[n-2], "side") == 0) {
+            side = atoi(t[n-1]);
+            n -= 2;
+        } else {
+            break;
+        }
+    }
+    uint delay_bits = 5 - program->sideset_bits;
+    if (delay >= (1 << delay_bits) || (side < 0 && program->sideset_bits > 0 && !program->sideset_opt)) {
+        return -1;
+    }
+    uint field = (uint)delay;
+    if (side >= 0) {
+        uint value = (uint)side | (program->sideset_opt ? 1u << (program->sideset_bits - 1) : 0);
+        field |= value << delay_bits;
+    }
+    int encoding = (int)field << 8;
+
+    const char *op = t[0];
+    int a, b;
+    if (strcmp(op, "jmp") == 0) {
+        a = (n == 3) ? ow_pio_lookup(t[1], jmp_conditions, 8) : 0;
+        const char *target = t[n-1];
+        b = -1;
+        for (int i = 0; i < num_labels; i++) {
+            if (strcmp(labels[i].name, target) == 0) {
+                b = (int)labels[i].address;
+            }
+        }
+        if (b < 0 && isdigit((unsigned char)target[0])) {
+            b = atoi(target);
+        }
+        if (a < 0 || b < 0) {
+            return -1;
+        }
+        return encoding | OW_PIO_JMP << 13 | a << 5 | b;
+    } else if (strcmp(op, "wait") == 0 && n == 4) {
+        a = ow_pio_lookup(t[2], wait_sources, 3);
+        return a < 0 ? -1 : encoding | OW_PIO_WAIT << 13 | (atoi(t[1]) & 1) << 7 | a << 5 | (atoi(t[3]) & 0x1f);
+    } else if (strcmp(op, "in") == 0 && n == 3) {
+        a = ow_pio_lookup(t[1], in_sources, 8);
+        return a < 0 ? -1 : encoding | OW_PIO_IN << 13 | a << 5 | (atoi(t[2]) & 0x1f);
+    } else if (strcmp(op, "out") == 0 && n == 3) {
+        a = ow_pio_lookup(t[1], out_destinations, 8);
+        return a < 0 ? -1 : encoding | OW_PIO_OUT << 13 | a << 5 | (atoi(t[2]) & 0x1f);
+    } else if (strcmp(op, "push") == 0 || strcmp(op, "pull") == 0) {
+        bool pull = op[1] == 'u' && op[2] == 'l';
+        bool conditional = false;
+        bool block = true;
+        for (int i = 1; i < n; i++) {
+            if (strcmp(t[i], "iffull") == 0 || strcmp(t[i], "ifempty") == 0) {
+                conditional = true;
+            } else if (strcmp(t[i], "noblock") == 0) {
+                block = false;
+            }
+        }
+        return encoding | OW_PIO_PUSHPULL << 13 | pull << 7 | conditional << 6 | block << 5;
+    } else if (strcmp(op, "mov") == 0 && n == 3) {
+        const char *source = t[2];
+        int operation = 0;
+        if (source[0] == '!' || source[0] == '~') {
+            operation = 1;
+            source += 1;
+        } else if (strncmp(source, "::", 2) == 0) {
+            operation = 2;
+            source += 2;
+        }
+        a = ow_pio_lookup(t[1], mov_destinations, 8);
+        b = ow_pio_lookup(source, mov_sources, 8);
+        return (a < 0 || b < 0) ? -1 : encoding | OW_PIO_MOV << 13 | a << 5 | operation << 3 | b;
+    } else if (strcmp(op, "nop") == 0 && n == 1) {
+        return encoding | OW_PIO_MOV << 13 | 2 << 5 | 2;    // mov y, y
+    } else if (strcmp(op, "set") == 0 && n == 3) {
+        a = ow_pio_lookup(t[1], set_destinations, 5);
+        return a < 0 ? -1 : encoding | OW_PIO_SET << 13 | a << 5 | (atoi(t[2]) & 0x1f);
+    }
+    return -1;
+}
+
+bool ow_pio_assemble(ow_pio_program *program, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    memset(program, 0, sizeof(*program));
+    program->offset_reset_bus = -1;
+    program->offset_fetch_bit = -1;
+
+    // First pass: directives and label addresses. Second pass: encode instructions.
+    ow_pio_label labels[OW_PIO_LABELS_MAX];
+    int num_labels = 0;
+    bool wrap_set = false;
+    bool ok = true;
+    for (int pass = 0; pass < 2 && ok; pass++) {
+        char buffer[OW_PIO_LINE_MAX];
+        uint address = 0;
+        rewind(file);
+        while (ok && fgets(buffer, sizeof(buffer), file) != NULL) {
+            char name[32];
+            char *line = ow_pio_split_label(ow_pio_trim(buffer), name, sizeof(name));
+            if (pass == 0 && name[0] != '\0' && num_labels < OW_PIO_LABELS_MAX) {
+                snprintf(labels[num_labels].name, sizeof(labels[num_labels].name), "%s", name);
+                labels[num_labels++].address = address;
+                if (strcmp(name, "reset_bus") == 0) {
+                    program->offset_reset_bus = (int)address;
+                } else if (strcmp(name, "fetch_bit") == 0) {
+                    program->offset_fetch_bit = (int)address;
+                }
+            }
+            if (line[0] == '\0') {
+                continue;
+            }
+            char *t[8];
+            int n = ow_pio_tokens(line, t, 8);
+            if (t[0][0] == '.') {
+                if (pass == 1) {
+                    continue;
+                }
+                if (strcmp(t[0], ".side_set") == 0 && n >= 2) {
+                    program->sideset_bits = (uint)atoi(t[1]);
+                    for (int i = 2; i < n; i++) {
+                        program->sideset_opt |= strcmp(t[i], "opt") == 0;
+                        program->sideset_pindirs |= strcmp(t[i], "pindirs") == 0;
+                    }
+                    program->sideset_bits += program->sideset_opt;
+                } else if (strcmp(t[0], ".wrap_target") == 0) {
+                    program->wrap_target = address;
+                } else if (strcmp(t[0], ".wrap") == 0) {
+                    program->wrap = address - 1;
+                    wrap_set = true;
+                }
+                continue;
+            }
+            if (address >= OW_PIO_EMU_MAX_INSTR) {
+                ok = false;
+                break;
+            }
+            if (pass == 1) {
+                int encoding = ow_pio_encode(t, n, program, labels, num_labels);
+                if (encoding < 0) {
+                    ok = false;
+                    break;
+                }
+                program->instructions[address] = (uint16_t)encoding;
+            }
+            address += 1;
+        }
+        program->length = address;
+    }
+    if (!wrap_set) {
+        program->wrap = program->length - 1;
+    }
+    fclose(file);
+    return ok && program->length > 0;
+}
+
+void ow_pio_emu_init(ow_pio_emu *emu, const ow_pio_program *program, ow_sim_bus *bus) {
+    memset(emu, 0, sizeof(*emu));
+    emu->program = *program;
+    emu->bus = bus;
+    emu->sys_hz = OW_PIO_EMU_SYS_HZ;
+    emu->clkdiv = (uint32_t)(emu->sys_hz / 1000000) << 8;  // 1 us per instruction, as set by the PIO backend.
+    emu->timing.rise_ns = OW_PIO_EMU_RISE_NS;
+    emu->timing.sample_us = 30;
+    emu->timing.drive_us = 30;
+    emu->timing.reset_min_us = 480;
+    emu->timing.presence_wait_us = 30;
+    emu->timing.presence_us = 120;
+    emu->threshold = 8;
+    emu->osr_count = 32;
+    emu->pc = program->offset_fetch_bit > 0 ? (uint)program->offset_fetch_bit : 0;
+}
+
+uint64_t ow_pio_emu_time_ns(const ow_pio_emu *emu) {
+    return (emu->sys_cycles / emu->sys_hz) * 1000000000ull + (emu->sys_cycles % emu->sys_hz) * 1000000000ull / emu->sys_hz;
+}
+
+/**
+ * @brief Bus value seen by the pin input: released by every driver for at least the rise time.
+ */
+static uint ow_pio_emu_pin(const ow_pio_emu *emu, uint64_t now) {
+    return !emu->line_low && now - emu->release_ns >= emu->timing.rise_ns;
+}
+
+/**
+ * @brief Update the simulated devices and the line state at the current time.
+ */
+static void ow_pio_emu_line(ow_pio_emu *emu, uint64_t now) {
+    const ow_pio_emu_timing *timing = &emu->timing;
+    emu->bus->now_us = now / 1000;
+
+    // Master edges: a falling edge starts a time slot and a long low pulse is a reset.
+    if (emu->pindir && !emu->master_low) {
+        emu->master_low = true;
+        if (emu->fall_ns != 0) {
+            emu->last_slot_ns = now - emu->fall_ns;
+        }
+        emu->fall_ns = now;
+        if (!ow_sim_slot_begin(emu->bus)) {
+            emu->device_low_until_ns = now + timing->drive_us * 1000ull;
+        }
+        emu->sample_at_ns = now + timing->sample_us * 1000ull;
+    } else if (!emu->pindir && emu->master_low) {
+        emu->master_low = false;
+        if (now - emu->fall_ns >= timing->reset_min_us * 1000ull) {
+            emu->last_reset_low_ns = now - emu->fall_ns;
+            emu->sample_at_ns = 0;
+            emu->device_low_until_ns = 0;
+            emu->presence_ns = ow_sim_reset(emu->bus) ? now + timing->presence_wait_us * 1000ull : 0;
+        }
+    }
+
+    // Devices holding the bus low: a 0 bit or the presence pulse.
+    bool device_low = now < emu->device_low_until_ns;
+    if (emu->presence_ns != 0 && now >= emu->presence_ns) {
+        if (now < emu->presence_ns + timing->presence_us * 1000ull) {
+            device_low = true;
+        } else {
+            emu->presence_ns = 0;
+        }
+    }
+
+    // Open-drain line: low while anyone drives it, then high a rise time after the last release.
+    bool low = emu->master_low || device_low;
+    if (!low && emu->line_low) {
+        emu->release_ns = now;
+    }
+    emu->line_low = low;
+
+    // Device sample point.
+    if (emu->sample_at_ns != 0 && now >= emu->sample_at_ns) {
+        emu->sample_at_ns = 0;
+        ow_sim_slot_end(emu->bus, ow_pio_emu_pin(emu, now));
+    }
+}
+
+/**
+ * @brief Value of a MOV or IN source.
+ */
+static uint32_t ow_pio_emu_source(ow_pio_emu *emu, uint source, uint64_t now) {
+    switch (source) {
+        case 0:
+            emu->last_sample_ns = now - emu->fall_ns;
+            return ow_pio_emu_pin(emu, now);
+        case 1: return emu->x;
+        case 2: return emu->y;
+        case 6: return emu->isr;
+        case 7: return emu->osr;
+        default: return 0;
+    }
+}
+
+static bool ow_pio_emu_push(ow_pio_emu *emu) {
+    if (emu->rx_len == OW_PIO_EMU_FIFO_DEPTH) {
+        return false;
+    }
+    emu->rx[emu->rx_len++] = emu->isr;
+    emu->isr = 0;
+    emu->isr_count = 0;
+    return true;
+}
+
+static bool ow_pio_emu_pull(ow_pio_emu *emu) {
+    if (emu->tx_len == 0) {
+        return false;
+    }
+    emu->osr = emu->tx[0];
+    memmove(emu->tx, emu->tx + 1, (emu->tx_len - 1) * sizeof(emu->tx[0]));
+    emu->tx_len -= 1;
+    emu->osr_count = 0;
+    return true;
+}
+
+/**
+ * @brief Execute one instruction. Returns false if it stalls, in which case it is retried on the next cycle.
+ */
+static bool ow_pio_emu_exec(ow_pio_emu *emu, uint16_t instr, uint64_t now, bool *jumped) {
+    uint op = instr >> 13;
+    uint arg1 = (instr >> 5) & 7;
+    uint arg2 = instr & 0x1f;
+    uint count = arg2 ? arg2 : 32;
+    uint32_t mask = count == 32 ? 0xffffffffu : (1u << count) - 1;
+    uint32_t data;
+    bool condition;
+
+    switch (op) {
+        case OW_PIO_JMP:
+            switch (arg1) {
+                case 1: condition = emu->x == 0; break;
+                case 2: condition = emu->x-- != 0; break;
+                case 3: condition = emu->y == 0; break;
+                case 4: condition = emu->y-- != 0; break;
+                case 5: condition = emu->x != emu->y; break;
+                case 6: condition = ow_pio_emu_pin(emu, now); break;
+                case 7: condition = emu->osr_count < emu->threshold; break;
+                default: condition = true; break;
+            }
+            if (condition) {
+                emu->pc = arg2;
+                *jumped = true;
+            }
+            return true;
+        case OW_PIO_WAIT:
+            return (arg1 & 3) == 2 || ow_pio_emu_pin(emu, now) == (arg1 >> 2);    // IRQ waits are not modelled.
+        case OW_PIO_IN:
+            if (emu->isr_count + count >= emu->threshold && emu->rx_len == OW_PIO_EMU_FIFO_DEPTH) {
+                return false;                                           // Autopush stalls on a full RX FIFO.
+            }
+            data = ow_pio_emu_source(emu, arg1, now) & mask;
+            emu->isr = count == 32 ? data : (emu->isr >> count) | (data << (32 - count));
+            emu->isr_count = emu->isr_count + count > 32 ? 32 : emu->isr_count + count;
+            if (emu->isr_count >= emu->threshold) {
+                ow_pio_emu_push(emu);
+            }
+            return true;
+        case OW_PIO_OUT:
+            if (emu->osr_count >= emu->threshold && !ow_pio_emu_pull(emu)) {
+                return false;                                           // Autopull stalls on an empty TX FIFO.
+            }
+            data = emu->osr & mask;
+            emu->osr = count == 32 ? 0 : emu->osr >> count;
+            emu->osr_count = emu->osr_count + count > 32 ? 32 : emu->osr_count + count;
+            switch (arg1) {
+                case 1: emu->x = data; break;
+                case 2: emu->y = data; break;
+                case 4: emu->pindir = data & 1; break;
+                case 5: emu->pc = data & 0x1f; *jumped = true; break;
+                case 6: emu->isr = data; emu->isr_count = count; break;
+                default: break;
+            }
+            return true;
+        case OW_PIO_PUSHPULL:
+            if (instr & 0x80) {
+                if ((instr & 0x40) && emu->osr_count < emu->threshold) {
+                    return true;
+                }
+                if (!ow_pio_emu_pull(emu)) {
+                    if (instr & 0x20) {
+                        return false;
+                    }
+                    emu->osr = emu->x;
+                    emu->osr_count = 0;
+                }
+            } else {
+                if ((instr & 0x40) && emu->isr_count < emu->threshold) {
+                    return true;
+                }
+                if (!ow_pio_emu_push(emu) && (instr & 0x20)) {
+                    return false;
+                }
+            }
+            return true;
+        case OW_PIO_MOV:
+            data = ow_pio_emu_source(emu, arg2 & 7, now);
+            if (((arg2 >> 3) & 3) == 1) {
+                data = ~data;
+            } else if (((arg2 >> 3) & 3) == 2) {
+                uint32_t reversed = 0;
+                for (uint i = 0; i < 32; i++) {
+                    reversed |= ((data >> i) & 1) << (31 - i);
+                }
+                data = reversed;
+            }
+            switch (arg1) {
+                case 1: emu->x = data; break;
+                case 2: emu->y = data; break;
+                case 5: emu->pc = data & 0x1f; *jumped = true; break;
+                case 6: emu->isr = data; emu->isr_count = 0; break;
+                case 7: emu->osr = data; emu->osr_count = 0; break;
+                default: break;
+            }
+            return true;
+        case OW_PIO_SET:
+            switch (arg1) {
+                case 1: emu->x = arg2; break;
+                case 2: emu->y = arg2; break;
+                case 4: emu->pindir = arg2 & 1; break;
+                default: break;
+            }
+            return true;
+        default:
+            return true;                                                // IRQ is not modelled.
+    }
+}
+
+void ow_pio_emu_step(ow_pio_emu *emu) {
+    uint64_t now = ow_pio_emu_time_ns(emu);
+    const ow_pio_program *program = &emu->program;
+
+    if (emu->exec_pending || emu->delay == 0) {
+        // Issue an instruction. Side-set takes effect even if the instruction stalls.
+        uint16_t instr = emu->exec_pending ? emu->exec_instr : program->instructions[emu->pc];
+        uint delay_bits = 5 - program->sideset_bits;
+        uint field = (instr >> 8) & 0x1f;
+        if (program->sideset_bits > 0) {
+            uint side = field >> delay_bits;
+            uint value_bits = program->sideset_bits - program->sideset_opt;
+            if (!program->sideset_opt || (side >> value_bits)) {
+                if (program->sideset_pindirs) {
+                    emu->pindir = side & 1;
+                }
+            }
+        }
+        ow_pio_emu_line(emu, now);
+
+        bool jumped = false;
+        emu->stalled = !ow_pio_emu_exec(emu, instr, now, &jumped);
+        if (!emu->stalled) {
+            emu->delay = field & ((1u << delay_bits) - 1);
+            if (emu->exec_pending) {
+                emu->exec_pending = false;
+            } else if (!jumped) {
+                emu->pc = emu->pc == program->wrap ? program->wrap_target : emu->pc + 1;
+            }
+        }
+    } else {
+        emu->delay -= 1;
+    }
+    ow_pio_emu_line(emu, now);
+    if (!emu->stalled) {
+        emu->busy_cycles += 1;
+    }
+
+    // Advance by one state machine clock.
+    emu->clkdiv_acc += emu->clkdiv;
+    emu->sys_cycles += emu->clkdiv_acc >> 8;
+    emu->clkdiv_acc &= 0xff;
+    if (emu->line_low) {
+        emu->low_ns += ow_pio_emu_time_ns(emu) - now;
+    }
+}
+
+/**
+ * @brief Nothing is in progress on the state machine or the line, so time can be skipped.
+ */
+static bool ow_pio_emu_idle(const ow_pio_emu *emu, uint64_t now) {
+    return emu->stalled && !emu->exec_pending && !emu->line_low && emu->sample_at_ns == 0 && emu->presence_ns == 0 &&
+           now >= emu->device_low_until_ns;
+}
+
+static void ow_pio_emu_configure(OW *ow, uint bits) {
+    ow_pio_emu *emu = ow->bus;
+    ow->bits = bits;
+    emu->threshold = bits;
+    emu->tx_len = 0;
+    emu->rx_len = 0;
+    emu->isr = 0;
+    emu->isr_count = 0;
+    emu->osr = 0;
+    emu->osr_count = 32;
+    emu->delay = 0;
+    emu->stalled = false;
+    emu->exec_pending = false;
+    emu->reset_pending = false;
+    emu->pc = (uint)emu->program.offset_fetch_bit;
+}
+
+static void ow_pio_emu_reset(OW *ow) {
+    ow_pio_emu *emu = ow->bus;
+    emu->reset_pending = true;
+    emu->exec_instr = (uint16_t)(OW_PIO_JMP << 13 | emu->program.offset_reset_bus);    // jmp reset_bus side 0
+    emu->exec_pending = true;
+    while (emu->exec_pending) {
+        ow_pio_emu_step(emu);
+    }
+}
+
+static void ow_pio_emu_put(OW *ow, uint32_t data) {
+    ow_pio_emu *emu = ow->bus;
+    while (emu->tx_len == OW_PIO_EMU_FIFO_DEPTH) {
+        ow_pio_emu_step(emu);
+    }
+    emu->tx[emu->tx_len++] = data;
+    emu->bus->fifo_ops += 1;
+}
+
+static bool ow_pio_emu_ready(OW *ow) {
+    ow_pio_emu *emu = ow->bus;
+    if (emu->rx_len == 0) {
+        ow_pio_emu_step(emu);               // Polling takes time.
+    }
+    return emu->rx_len > 0;
+}
+
+static uint32_t ow_pio_emu_get(OW *ow) {
+    ow_pio_emu *emu = ow->bus;
+    while (emu->rx_len == 0) {
+        ow_pio_emu_step(emu);
+    }
+    uint32_t word = emu->rx[0];
+    memmove(emu->rx, emu->rx + 1, (emu->rx_len - 1) * sizeof(emu->rx[0]));
+    emu->rx_len -= 1;
+    emu->bus->fifo_ops += 1;
+    if (emu->reset_pending) {
+        emu->reset_pending = false;
+        return word & 1;
+    }
+    return word >> (32 - ow->bits);
+}
+
+static void ow_pio_emu_sleep_us(OW *ow, uint32_t us) {
+    ow_pio_emu *emu = ow->bus;
+    uint64_t now = ow_pio_emu_time_ns(emu);
+    uint64_t end = now + us * 1000ull;
+    while (now < end) {
+        if (ow_pio_emu_idle(emu, now)) {
+            emu->sys_cycles += (end - now) * emu->sys_hz / 1000000000ull;
+            ow_pio_emu_line(emu, end);
+            break;
+        }
+        ow_pio_emu_step(emu);
+        now = ow_pio_emu_time_ns(emu);
+    }
+}
+
+static uint64_t ow_pio_emu_time_us(OW *ow) {
+    return ow_pio_emu_time_ns(ow->bus) / 1000;
+}
+
+static const ow_backend ow_pio_emu_backend = {
+    ow_pio_emu_configure,
+    ow_pio_emu_reset,
+    ow_pio_emu_put,
+    ow_pio_emu_ready,
+    ow_pio_emu_get,
+    ow_pio_emu_sleep_us,
+    ow_pio_emu_time_us,
+}; /**< Emulated PIO backend. */
+
+void ow_pio_emu_attach(OW *ow, ow_pio_emu *emu) {
+    ow->backend = &ow_pio_emu_backend;
+    ow->bus = emu;
+    ow->timing = (ow_timing){OW_RESET_US, OW_SLOT_US};
+    ow->single_drop = false;
+    ow->single_drop_selects = 0;
+    ow->resume = false;
+    ow->rom_phase = false;
+    ow_stats_reset(ow);
+#if OW_HIST
+    ow->hist = NULL;
+#endif
+#if OW_TRACE
+    ow->trace = NULL;
+#endif
+    ow_pio_emu_configure(ow, 8);
+}
@@ -0,0 +1,134 @@
+#include "include/ow_registry.h"
+#include <string.h>
+
+/**
+ * @brief Sort key placing the family byte above the rest of the ROM code.
+ */
+static uint64_t ow_registry_key(uint64_t romcode) {
+    return (romcode << 56) | (romcode >> 8);
+}
+
+void ow_registry_init(ow_registry *reg) {
+    memset(reg, 0, sizeof(*reg));
+    memset(reg->index, OW_REGISTRY_NONE, sizeof(reg->index));
+}
+
+bool ow_registry_set_driver(ow_registry *reg, uint8_t family, ow_driver driver) {
+    uint8_t slice = reg->index[family];
+    if (slice == OW_REGISTRY_NONE) {
+        // Add an empty slice so the driver is in place before any devices are found.
+        if (reg->num_families >= OW_REGISTRY_MAX_FAMILIES) {
+            return false;
+        }
+        slice = reg->num_families++;
+        reg->families[slice].family = family;
+        reg->families[slice].start = reg->num_devices;
+        reg->families[slice].count = 0;
+        reg->index[family] = slice;
+    }
+    reg->families[slice].driver = driver;
+    return true;
+}
+
+bool ow_registry_build(ow_registry *reg, const uint64_t *romcodes, int num_devices) {
+    if (num_devices < 0 || num_devices > OW_REGISTRY_MAX_DEVICES) {
+        return false;
+    }
+
+    // Build into a new registry so that a failure leaves the current one, and its drivers, untouched.
+    ow_registry next;
+    ow_registry_init(&next);
+
+    // Insertion sort by family then ROM code.
+    for (int i = 0; i < num_devices; i++) {
+        uint64_t romcode = romcodes[i];
+        int j = i;
+        while (j > 0 && ow_registry_key(next.romcodes[j-1]) > ow_registry_key(romcode)) {
+            next.romcodes[j] = next.romcodes[j-1];
+            j--;
+        }
+        next.romcodes[j] = romcode;
+    }
+    next.num_devices = (uint16_t)num_devices;
+
+    // Cut into family slices.
+    for (int i = 0; i < num_devices; i++) {
+        uint8_t family = ow_family(&next.romcodes[i]);
+        if (next.index[family] == OW_REGISTRY_NONE) {
+            if (next.num_families >= OW_REGISTRY_MAX_FAMILIES) {
+                return false;
+            }
+            uint8_t slice = next.num_families++;
+            next.families[slice].family = family;
+            next.families[slice].start = (uint16_t)i;
+            next.families[slice].count = 0;
+            next.families[slice].driver = NULL;
+            next.index[family] = slice;
+        }
+        next.families[next.index[family]].count++;
+    }
+
+    // Keep the drivers of the previous build, with an empty slice for families with a driver but no devices.
+    for (int i = 0; i < reg->num_families; i++) {
+        if (reg->families[i].driver != NULL &&
+            !ow_registry_set_driver(&next, reg->families[i].family, reg->families[i].driver)) {
+            return false;
+        }
+    }
+    *reg = next;
+    return true;
+}
+
+uint64_t *ow_registry_family(ow_registry *reg, uint8_t family, int *count) {
+    uint8_t slice = reg->index[family];
+    if (slice == OW_REGISTRY_NONE || reg->families[slice].count == 0) {
+        *count = 0;
+        return NULL;
+    }
+    *count = reg->families[slice].count;
+    return &reg->romcodes[reg->families[slice].start];
+}
+
+int ow_registry_find(const ow_registry *reg, uint64_t romcode) {
+    uint8_t slice = reg->index[ow_family(&romcode)];
+    if (slice == OW_REGISTRY_NONE) {
+        return -1;
+    }
+
+    // Binary search within the family slice.
+    int low = reg->families[slice].start;
+    int high = low + reg->families[slice].count - 1;
+    uint64_t key = ow_registry_key(romcode);
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        uint64_t mid_key = ow_registry_key(reg->romcodes[mid]);
+        if (mid_key == key) {
+            return mid;
+        } else if (mid_key < key) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+int ow_registry_dispatch(ow_registry *reg, OW *ow, uint8_t family, void *context) {
+    uint8_t slice = reg->index[family];
+    if (slice == OW_REGISTRY_NONE || reg->families[slice].driver == NULL) {
+        return 0;
+    }
+    ow_family_slice *f = &reg->families[slice];
+    for (int i = f->start; i < f->start + f->count; i++) {
+        f->driver(ow, &reg->romcodes[i], context);
+    }
+    return f->count;
+}
+
+int ow_registry_dispatch_all(ow_registry *reg, OW *ow, void *context) {
+    int count = 0;
+    for (int i = 0; i < reg->num_families; i++) {
+        count += ow_registry_dispatch(reg, ow, reg->families[i].family, context);
+    }
+    return count;
+}
@@ -0,0 +1,341 @@
+#include "include/ow_sim.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define OW_SIM_ROM_COMMAND  0       /**< Receiving the ROM command. */
+#define OW_SIM_MATCH        1       /**< Receiving the ROM code of MATCH ROM. */
+#define OW_SIM_SEARCH       2       /**< Taking part in a search. */
+#define OW_SIM_FUNCTION     3       /**< Selected: bytes go to the function layer. */
+#define OW_SIM_IDLE         4       /**< Not selected: waiting for the next reset. */
+
+void ow_sim_bus_init(ow_sim_bus *bus) {
+    memset(bus, 0, sizeof(*bus));
+}
+
+void ow_sim_bus_free(ow_sim_bus *bus) {
+    free(bus->devices);
+    free(bus->active);
+    bus->devices = NULL;
+    bus->active = NULL;
+    bus->num_devices = 0;
+    bus->num_active = 0;
+    bus->capacity = 0;
+}
+
+void ow_sim_device_init(ow_sim_device *dev, uint64_t romcode, const ow_sim_device_ops *ops) {
+    memset(dev, 0, sizeof(*dev));
+    dev->romcode = romcode;
+    dev->ops = ops;
+    dev->state = OW_SIM_IDLE;
+}
+
+bool ow_sim_attach(ow_sim_bus *bus, ow_sim_device *dev) {
+    if (bus->num_devices == bus->capacity) {
+        int capacity = bus->capacity ? 2 * bus->capacity : 16;
+        ow_sim_device **devices = realloc(bus->devices, capacity * sizeof(*devices));
+        if (devices == NULL) {
+            return false;
+        }
+        bus->devices = devices;
+        ow_sim_device **active = realloc(bus->active, capacity * sizeof(*active));
+        if (active == NULL) {
+            return false;
+        }
+        bus->active = active;
+        bus->capacity = capacity;
+    }
+    dev->bus = bus;
+    dev->state = OW_SIM_IDLE;           // Joins in at the next reset.
+    bus->devices[bus->num_devices++] = dev;
+    return true;
+}
+
+void ow_sim_detach(ow_sim_bus *bus, ow_sim_device *dev) {
+    for (int i = 0; i < bus->num_devices; i++) {
+        if (bus->devices[i] == dev) {
+            bus->devices[i] = bus->devices[--bus->num_devices];
+            break;
+        }
+    }
+    for (int i = 0; i < bus->num_active; i++) {
+        if (bus->active[i] == dev) {
+            bus->active[i] = bus->active[--bus->num_active];
+            break;
+        }
+    }
+    dev->bus = NULL;
+}
+
+bool ow_sim_transmit(ow_sim_device *dev, const uint8_t *data, size_t len) {
+    // Drop bytes that have been sent.
+    uint16_t sent = dev->tx_pos / 8;
+    memmove(dev->tx, dev->tx + sent, dev->tx_len - sent);
+    dev->tx_len -= sent;
+    dev->tx_pos -= 8 * sent;
+    if (dev->tx_len + len > OW_SIM_TX_SIZE) {
+        return false;
+    }
+    memcpy(dev->tx + dev->tx_len, data, len);
+    dev->tx_len += len;
+    return true;
+}
+
+bool ow_sim_reset(ow_sim_bus *bus) {
+    bus->resets += 1;
+    bus->num_active = 0;
+    for (int i = 0; i < bus->num_devices; i++) {
+        ow_sim_device *dev = bus->devices[i];
+        dev->state = OW_SIM_ROM_COMMAND;
+        dev->rx_bits = 0;
+        dev->tx_len = 0;
+        dev->tx_pos = 0;
+        if (dev->ops != NULL && dev->ops->reset != NULL) {
+            dev->ops->reset(dev);
+        }
+        bus->active[bus->num_active++] = dev;
+    }
+    return bus->num_devices > 0;
+}
+
+/**
+ * @brief Bit a device drives in the current time slot (1 leaves the bus released).
+ */
+static uint ow_sim_output(ow_sim_device *dev) {
+    switch (dev->state) {
+        case OW_SIM_SEARCH: {
+            uint rom_bit = (dev->search_romcode >> dev->bit) & 1;   // bit < 64 while searching.
+            if (dev->phase == 0) {
+                return rom_bit;
+            } else if (dev->phase == 1) {
+                return !rom_bit;
+            }
+            return 1;
+        }
+        case OW_SIM_FUNCTION:
+            if (dev->tx_pos < 8 * dev->tx_len) {
+                return (dev->tx[dev->tx_pos / 8] >> (dev->tx_pos % 8)) & 1;
+            }
+            if (dev->ops != NULL && dev->ops->idle_bit != NULL) {
+                return dev->ops->idle_bit(dev);
+            }
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Handle a complete ROM command byte.
+ */
+static void ow_sim_rom_command(ow_sim_device *dev, uint8_t command) {
+    dev->bit = 0;
+    dev->phase = 0;
+    dev->search_romcode = dev->romcode;
+    if (command != OW_RESUME) {
+        dev->resume = false;        // Any other ROM command clears the resume flag.
+    }
+    switch (command) {
+        case OW_READ_ROM: {
+            uint8_t rom[8];
+            for (int i = 0; i < 8; i++) {
+                rom[i] = (uint8_t)(dev->romcode >> (8*i));
+            }
+            dev->state = OW_SIM_FUNCTION;
+            ow_sim_transmit(dev, rom, sizeof(rom));
+            break;
+        }
+        case OW_MATCH_ROM:
+            dev->state = OW_SIM_MATCH;
+            break;
+        case OW_SKIP_ROM:
+            dev->state = OW_SIM_FUNCTION;
+            break;
+        case OW_RESUME:
+            dev->state = dev->resumable && dev->resume ? OW_SIM_FUNCTION : OW_SIM_IDLE;
+            break;
+        case OW_ALARM_SEARCH:
+            if (dev->ops == NULL || dev->ops->alarm == NULL || !dev->ops->alarm(dev)) {
+                dev->state = OW_SIM_IDLE;
+                break;
+            }
+            dev->state = OW_SIM_SEARCH;
+            break;
+        case OW_SEARCH_ROM:
+            dev->state = OW_SIM_SEARCH;
+            break;
+        default:
+            dev->state = OW_SIM_IDLE;
+            break;
+    }
+}
+
+/**
+ * @brief Sample the bus at the end of the current time slot.
+ */
+static void ow_sim_input(ow_sim_device *dev, uint line) {
+    uint rom_bit;
+    switch (dev->state) {
+        case OW_SIM_ROM_COMMAND:
+            dev->rx_byte |= line << dev->rx_bits;
+            if (++dev->rx_bits == 8) {
+                uint8_t command = dev->rx_byte;
+                dev->rx_byte = 0;
+                dev->rx_bits = 0;
+                ow_sim_rom_command(dev, command);
+            }
+            break;
+        case OW_SIM_MATCH:
+            rom_bit = (dev->romcode >> dev->bit) & 1;   // bit < 64 while matching.
+            if (line != rom_bit) {
+                dev->state = OW_SIM_IDLE;
+            } else if (++dev->bit == 64) {
+                dev->state = OW_SIM_FUNCTION;
+                dev->resume = true;
+            }
+            break;
+        case OW_SIM_SEARCH:
+            rom_bit = (dev->search_romcode >> dev->bit) & 1;
+            if (dev->phase < 2) {
+                dev->phase += 1;
+            } else if (line != rom_bit) {
+                dev->state = OW_SIM_IDLE;   // Master took the other branch.
+            } else {
+                dev->phase = 0;
+                if (++dev->bit == 64) {
+                    dev->state = OW_SIM_FUNCTION;
+                } else if (dev->bit == 56 && dev->corrupt_searches > 0) {
+                    dev->corrupt_searches--;
+                    dev->search_romcode ^= 1ull << 56;  // Flip a CRC bit of the pass that reaches it.
+                }
+            }
+            break;
+        case OW_SIM_FUNCTION:
+            if (dev->tx_pos < 8 * dev->tx_len) {
+                dev->tx_pos += 1;           // Master read a bit.
+                break;
+            }
+            dev->rx_byte |= line << dev->rx_bits;
+            if (++dev->rx_bits == 8) {
+                uint8_t byte = dev->rx_byte;
+                dev->rx_byte = 0;
+                dev->rx_bits = 0;
+                if (dev->ops != NULL && dev->ops->receive != NULL) {
+                    dev->ops->receive(dev, byte);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+uint ow_sim_slot_begin(ow_sim_bus *bus) {
+    // Wired AND of every device still taking part.
+    uint line = 1;
+    for (int i = 0; i < bus->num_active && line; i++) {
+        line &= ow_sim_output(bus->active[i]);
+    }
+    return line;
+}
+
+void ow_sim_slot_end(ow_sim_bus *bus, uint line) {
+    // Every device samples the bus; drop those that are no longer selected.
+    int n = 0;
+    for (int i = 0; i < bus->num_active; i++) {
+        ow_sim_device *dev = bus->active[i];
+        ow_sim_input(dev, line);
+        if (dev->state != OW_SIM_IDLE) {
+            bus->active[n++] = dev;
+        }
+    }
+    bus->num_active = n;
+    bus->slots += 1;
+}
+
+uint ow_sim_slot(ow_sim_bus *bus, uint bit) {
+    uint line = (bit & 1) & ow_sim_slot_begin(bus);
+    ow_sim_slot_end(bus, line);
+    return line;
+}
+
+static void ow_sim_push(ow_sim_bus *bus, uint32_t result) {
+    if (bus->fifo_len < OW_SIM_FIFO_DEPTH) {
+        bus->fifo[bus->fifo_len++] = result;
+    }
+}
+
+static void ow_sim_configure(OW *ow, uint bits) {
+    ow->bits = bits;
+}
+
+static void ow_sim_backend_reset(OW *ow) {
+    ow_sim_bus *bus = ow->bus;
+    ow_sim_push(bus, ow_sim_reset(bus) ? 0 : 1);
+    bus->now_us += ow->timing.reset_us;
+}
+
+static void ow_sim_put(OW *ow, uint32_t data) {
+    ow_sim_bus *bus = ow->bus;
+    uint32_t result = 0;
+    for (uint i = 0; i < ow->bits; i++) {
+        result |= (uint32_t)ow_sim_slot(bus, (data >> i) & 1) << i;
+    }
+    bus->now_us += ow->bits * ow->timing.slot_us;
+    bus->fifo_ops += 1;
+    ow_sim_push(bus, result);
+}
+
+static bool ow_sim_ready(OW *ow) {
+    ow_sim_bus *bus = ow->bus;
+    return bus->fifo_len > 0;
+}
+
+static uint32_t ow_sim_get(OW *ow) {
+    ow_sim_bus *bus = ow->bus;
+    if (bus->fifo_len == 0) {
+        abort();                        // Would block forever on hardware.
+    }
+    uint32_t result = bus->fifo[0];
+    memmove(bus->fifo, bus->fifo + 1, (bus->fifo_len - 1) * sizeof(bus->fifo[0]));
+    bus->fifo_len -= 1;
+    bus->fifo_ops += 1;
+    return result;
+}
+
+static void ow_sim_sleep_us(OW *ow, uint32_t us) {
+    ow_sim_bus *bus = ow->bus;
+    bus->now_us += us;
+}
+
+static uint64_t ow_sim_time_us(OW *ow) {
+    ow_sim_bus *bus = ow->bus;
+    return bus->now_us;
+}
+
+static const ow_backend ow_sim_backend = {
+    ow_sim_configure,
+    ow_sim_backend_reset,
+    ow_sim_put,
+    ow_sim_ready,
+    ow_sim_get,
+    ow_sim_sleep_us,
+    ow_sim_time_us,
+}; /**< Simulated bus backend. */
+
+void ow_sim_init(OW *ow, ow_sim_bus *bus) {
+    ow->backend = &ow_sim_backend;
+    ow->bus = bus;
+    ow->bits = 8;
+    ow->timing = (ow_timing){OW_RESET_US, OW_SLOT_US};
+    ow->single_drop = false;
+    ow->single_drop_selects = 0;
+    ow->resume = false;
+    ow->rom_phase = false;
+    ow_stats_reset(ow);
+#if OW_HIST
+    ow->hist = NULL;
+#endif
+#if OW_TRACE
+    ow->trace = NULL;
+#endif
+}
@@ -0,0 +1,82 @@
+#include "include/ow_trace.h"
+
+static void ow_trace_put32(uint8_t *buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buffer[i] = (uint8_t)(value >> (8*i));
+    }
+}
+
+bool ow_trace_init(ow_trace *trace, ow_trace_event *events, uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    trace->events = events;
+    trace->mask = capacity - 1;
+    trace->head = 0;
+    trace->phase = OW_TRACE_WRITE;
+    trace->rom_bytes = 0;
+    return true;
+}
+
+#if OW_TRACE
+void ow_trace_attach(OW *ow, ow_trace *trace) {
+    ow->trace = trace;
+}
+
+void ow_trace_record(OW *ow, uint type, uint8_t data, uint32_t time_us) {
+    ow_trace *trace = ow->trace;
+    if (type == OW_TRACE_RESET) {
+        trace->phase = OW_TRACE_ROM_COMMAND;
+    } else if (type == OW_TRACE_WRITE) {
+        // Classify the byte from its position in the transaction.
+        type = trace->phase;
+        if (type == OW_TRACE_ROM_COMMAND) {
+            if (data == OW_MATCH_ROM) {
+                trace->phase = OW_TRACE_ROM_BYTE;
+                trace->rom_bytes = 8;
+            } else {
+                trace->phase = data == OW_SKIP_ROM || data == OW_RESUME ? OW_TRACE_COMMAND : OW_TRACE_WRITE;
+            }
+        } else if (type == OW_TRACE_ROM_BYTE) {
+            if (--trace->rom_bytes == 0) {
+                trace->phase = OW_TRACE_COMMAND;
+            }
+        } else if (type == OW_TRACE_COMMAND) {
+            trace->phase = OW_TRACE_WRITE;
+        }
+    }
+    ow_trace_event *event = &trace->events[trace->head++ & trace->mask];
+    event->time_us = time_us;
+    event->type = (uint8_t)type;
+    event->data = data;
+}
+#endif
+
+uint32_t ow_trace_count(const ow_trace *trace) {
+    return trace->head > trace->mask ? trace->mask + 1 : trace->head;
+}
+
+size_t ow_trace_dump(const ow_trace *trace, uint8_t *buffer, size_t size) {
+    uint32_t count = ow_trace_count(trace);
+    size_t len = OW_TRACE_HEADER_SIZE + (size_t)count * OW_TRACE_EVENT_SIZE;
+    if (size < len) {
+        return 0;
+    }
+    ow_trace_put32(&buffer[0], OW_TRACE_MAGIC);
+    ow_trace_put32(&buffer[4], OW_TRACE_VERSION);
+    ow_trace_put32(&buffer[8], count);
+    ow_trace_put32(&buffer[12], trace->head - count);      // Events overwritten.
+
+    // Oldest first.
+    uint8_t *p = &buffer[OW_TRACE_HEADER_SIZE];
+    for (uint32_t i = trace->head - count; i != trace->head; i++) {
+        const ow_trace_event *event = &trace->events[i & trace->mask];
+        ow_trace_put32(p, event->time_us);
+        p[4] = event->type;
+        p[5] = event->data;
+        p[6] = 0;
+        p[7] = 0;
+        p += OW_TRACE_EVENT_SIZE;
+    }
+    return len;
+}
@@ -0,0 +1,88 @@
+#include "ds2431_sim.h"
+#include <stdio.h>
+
+#define FLEET_TEST_DEVICES  4       /**< Devices on the bus. */
+
+static int failures = 0;
+
+#define CHECK(condition) do {                                               \
+        if (!(condition)) {                                                 \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief Make a ROM code with a valid CRC.
+ */
+static uint64_t make_romcode(uint8_t family, uint8_t serial) {
+    uint8_t rom[8] = {family, serial, 1, 2, 3, 4, 5};
+    rom[7] = ow_crc_8(rom, 7);
+    uint64_t romcode = 0;
+    for (int i = 0; i < 8; i++) {
+        romcode |= (uint64_t)rom[i] << (8*i);
+    }
+    return romcode;
+}
+
+int main(void) {
+    ow_sim_bus bus;
+    ow_sim_bus_init(&bus);
+    ds2431_sim sims[FLEET_TEST_DEVICES];
+    uint64_t romcodes[FLEET_TEST_DEVICES];
+    for (int d = 0; d < FLEET_TEST_DEVICES; d++) {
+        romcodes[d] = make_romcode(DS2431_FAMILY, (uint8_t)(d + 1));
+        ds2431_sim_init(&sims[d], romcodes[d]);
+        ow_sim_attach(&bus, &sims[d].dev);
+    }
+    OW ow;
+    ow_sim_init(&ow, &bus);
+
+    uint8_t data[2 * DS2431_ROW_SIZE];
+    bool status[FLEET_TEST_DEVICES];
+
+    // No faults: every device is written.
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(0x10 + i);
+    }
+    CHECK(ds2431_write_fleet(&ow, romcodes, FLEET_TEST_DEVICES, 0x20, data, sizeof(data), status) == FLEET_TEST_DEVICES);
+    for (int d = 0; d < FLEET_TEST_DEVICES; d++) {
+        CHECK(status[d]);
+        CHECK(memcmp(&sims[d].memory[0x20], data, sizeof(data)) == 0);
+    }
+
+    // A transient verify failure on one device: its scratchpad is rewritten and checked again.
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(0x40 + i);
+    }
+    sims[1].corrupt_reads = 1;
+    CHECK(ds2431_write_fleet(&ow, romcodes, FLEET_TEST_DEVICES, 0x20, data, sizeof(data), status) == FLEET_TEST_DEVICES);
+    CHECK(sims[1].corrupt_reads == 0);
+    for (int d = 0; d < FLEET_TEST_DEVICES; d++) {
+        CHECK(status[d]);
+        CHECK(memcmp(&sims[d].memory[0x20], data, sizeof(data)) == 0);
+    }
+
+    // A persistent verify failure: the device rejects the copy and keeps its old contents.
+    uint8_t old[sizeof(data)];
+    memcpy(old, data, sizeof(data));
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(0x80 + i);
+    }
+    sims[2].corrupt_reads = 0xFF;
+    CHECK(ds2431_write_fleet(&ow, romcodes, FLEET_TEST_DEVICES, 0x20, data, sizeof(data), status) == FLEET_TEST_DEVICES - 1);
+    sims[2].corrupt_reads = 0;
+    for (int d = 0; d < FLEET_TEST_DEVICES; d++) {
+        CHECK(status[d] == (d != 2));
+        CHECK(memcmp(&sims[d].memory[0x20], d == 2 ? old : data, sizeof(data)) == 0);
+    }
+
+    // The copies are not polled, so each row waits the whole programming time.
+    uint64_t start_us = ow_time_us(&ow);
+    CHECK(ds2431_write_fleet(&ow, romcodes, FLEET_TEST_DEVICES, 0x20, data, DS2431_ROW_SIZE, status) == FLEET_TEST_DEVICES);
+    CHECK(ow_time_us(&ow) - start_us >= DS2431_PROG_US);
+
+    ow_sim_bus_free(&bus);
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
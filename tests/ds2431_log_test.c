@@ -0,0 +1,213 @@
+#include "ds2431_sim.h"
+#include "ds2431_log.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(condition) do {                                               \
+        if (!(condition)) {                                                 \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief Make a ROM code with a valid CRC.
+ */
+static uint64_t make_romcode(uint8_t family, uint8_t serial) {
+    uint8_t rom[8] = {family, serial, 1, 2, 3, 4, 5};
+    rom[7] = ow_crc_8(rom, 7);
+    uint64_t romcode = 0;
+    for (int i = 0; i < 8; i++) {
+        romcode |= (uint64_t)rom[i] << (8*i);
+    }
+    return romcode;
+}
+
+/**
+ * @brief Check that a mount of the device sees the same records as a log kept in memory.
+ */
+static bool same_as_mount(ds2431_log *log) {
+    ds2431_log mounted;
+    if (!ds2431_log_mount(&mounted, log->ow, &log->romcode)) {
+        return false;
+    }
+    return mounted.count == log->count && mounted.head == log->head && mounted.seq == log->seq &&
+           memcmp(mounted.entries, log->entries, log->count * sizeof(log->entries[0])) == 0;
+}
+
+/**
+ * @brief Events wrap: the ring keeps the newest records and a mount finds the same ones.
+ */
+static void test_wrap(OW *ow, ds2431_sim *sim, uint64_t *romcode) {
+    ds2431_log log;
+    memset(sim->memory, 0xFF, DS2431_SIZE);
+    CHECK(ds2431_log_mount(&log, ow, romcode));
+    CHECK(ds2431_log_count(&log) == 0);
+
+    for (int i = 0; i < 3 * DS2431_ROWS + 5; i++) {
+        uint8_t data[4] = {(uint8_t)i};
+        CHECK(ds2431_log_append(&log, DS2431_LOG_EVENT, data, sizeof(data)));
+    }
+    CHECK(ds2431_log_count(&log) == DS2431_ROWS);
+    uint8_t data[4];
+    CHECK(ds2431_log_get(&log, 0, NULL, data, sizeof(data)) == 4 && data[0] == 2 * DS2431_ROWS + 5);
+    CHECK(same_as_mount(&log));
+
+    // Multi-row records wrap from the last row to the first.
+    uint8_t big[20] = {0xB1};
+    CHECK(ds2431_log_append(&log, DS2431_LOG_EVENT, big, sizeof(big)));
+    CHECK(same_as_mount(&log));
+}
+
+/**
+ * @brief Keyed records survive wrapping (compaction) and a full ring of keys rejects appends.
+ */
+static void test_compaction(OW *ow, ds2431_sim *sim, uint64_t *romcode) {
+    ds2431_log log;
+    memset(sim->memory, 0xFF, DS2431_SIZE);
+    CHECK(ds2431_log_mount(&log, ow, romcode));
+
+    uint8_t config[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    CHECK(ds2431_log_append(&log, 1, config, sizeof(config)));
+    uint8_t stale[1] = {0x55};
+    CHECK(ds2431_log_append(&log, 2, stale, sizeof(stale)));
+    CHECK(ds2431_log_append(&log, 2, NULL, 0));        // Delete key 2.
+    for (int i = 0; i < 4 * DS2431_ROWS; i++) {
+        uint8_t data[2] = {(uint8_t)i};
+        CHECK(ds2431_log_append(&log, DS2431_LOG_EVENT, data, sizeof(data)));
+    }
+    uint8_t buffer[DS2431_LOG_MAX_DATA];
+    CHECK(ds2431_log_find(&log, 1, buffer, sizeof(buffer)) == sizeof(config));
+    CHECK(memcmp(buffer, config, sizeof(config)) == 0);
+    CHECK(ds2431_log_find(&log, 2, buffer, sizeof(buffer)) == -1);
+    CHECK(same_as_mount(&log));
+
+    // Fill the ring with keys that must be kept.
+    memset(sim->memory, 0xFF, DS2431_SIZE);
+    CHECK(ds2431_log_mount(&log, ow, romcode));
+    for (int key = 1; key < DS2431_ROWS; key++) {
+        uint8_t data[1] = {(uint8_t)key};
+        CHECK(ds2431_log_append(&log, key, data, sizeof(data)));
+    }
+    uint8_t data[1] = {0};
+    CHECK(!ds2431_log_append(&log, DS2431_ROWS, data, sizeof(data)));   // No row left to move a key through.
+    CHECK(same_as_mount(&log));
+    CHECK(ds2431_log_append(&log, 3, data, sizeof(data)));              // Replacing a key still fits.
+    CHECK(ds2431_log_find(&log, 3, buffer, sizeof(buffer)) == 1 && buffer[0] == 0);
+    CHECK(same_as_mount(&log));
+}
+
+/**
+ * @brief A record with a bad CRC (e.g. a torn append) ends the log at the record before it.
+ */
+static void test_bad_crc(OW *ow, ds2431_sim *sim, uint64_t *romcode) {
+    ds2431_log log;
+    memset(sim->memory, 0xFF, DS2431_SIZE);
+    CHECK(ds2431_log_mount(&log, ow, romcode));
+    for (int i = 0; i < 6; i++) {
+        uint8_t data[4] = {(uint8_t)i};
+        CHECK(ds2431_log_append(&log, DS2431_LOG_EVENT, data, sizeof(data)));
+    }
+
+    // Corrupt the newest record: the mount falls back to the one before.
+    sim->memory[log.entries[5].row * DS2431_ROW_SIZE + DS2431_LOG_HEADER_SIZE] ^= 0x01;
+    ds2431_log mounted;
+    CHECK(ds2431_log_mount(&mounted, ow, romcode));
+    CHECK(ds2431_log_count(&mounted) == 5);
+    CHECK(mounted.head == log.entries[5].row);
+    uint8_t data[4] = {0xA0};
+    CHECK(ds2431_log_append(&mounted, DS2431_LOG_EVENT, data, sizeof(data)));
+    CHECK(same_as_mount(&mounted));
+
+    // Corrupt a middle record: only the records after it remain.
+    sim->memory[mounted.entries[2].row * DS2431_ROW_SIZE + DS2431_LOG_HEADER_SIZE] ^= 0x80;
+    CHECK(ds2431_log_mount(&mounted, ow, romcode));
+    CHECK(ds2431_log_count(&mounted) == 3);
+    CHECK(ds2431_log_get(&mounted, 2, NULL, data, sizeof(data)) == 4 && data[0] == 0xA0);
+
+    // Erased (zero) memory holds no records.
+    memset(sim->memory, 0, DS2431_SIZE);
+    CHECK(ds2431_log_mount(&mounted, ow, romcode));
+    CHECK(ds2431_log_count(&mounted) == 0);
+}
+
+/**
+ * @brief Check that the keyed records of test_power_loss can be found after a mount.
+ */
+static bool keys_intact(OW *ow, uint64_t *romcode, const uint8_t *small, const uint8_t *large) {
+    ds2431_log log;
+    uint8_t buffer[DS2431_LOG_MAX_DATA];
+    return ds2431_log_mount(&log, ow, romcode) &&
+           ds2431_log_find(&log, 1, buffer, sizeof(buffer)) == 10 && memcmp(buffer, small, 10) == 0 &&
+           ds2431_log_find(&log, 2, buffer, sizeof(buffer)) == 20 && memcmp(buffer, large, 20) == 0;
+}
+
+/**
+ * @brief Power lost after any row of an append, including halfway through moving a kept record, loses no key.
+ */
+static void test_power_loss(OW *ow, ds2431_sim *sim, uint64_t *romcode) {
+    ds2431_log log;
+    memset(sim->memory, 0xFF, DS2431_SIZE);
+    CHECK(ds2431_log_mount(&log, ow, romcode));
+    uint8_t small[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};       // Two rows.
+    uint8_t large[20];                                          // Three rows.
+    for (int i = 0; i < 20; i++) {
+        large[i] = (uint8_t)(0xC0 + i);
+    }
+    CHECK(ds2431_log_append(&log, 1, small, sizeof(small)));
+    CHECK(ds2431_log_append(&log, 2, large, sizeof(large)));
+
+    bool moved = false;
+    for (int i = 0; i < 3 * DS2431_ROWS; i++) {
+        uint8_t snapshot[DS2431_SIM_MEMORY_SIZE];
+        memcpy(snapshot, sim->memory, sizeof(snapshot));
+        uint8_t event[4] = {(uint8_t)i};
+
+        // Cut the append off after each number of rows programmed.
+        for (int copies = 0; copies < DS2431_ROWS; copies++) {
+            memcpy(sim->memory, snapshot, sizeof(snapshot));
+            CHECK(ds2431_log_mount(&log, ow, romcode));
+            sim->copies_left = copies;
+            bool appended = ds2431_log_append(&log, DS2431_LOG_EVENT, event, sizeof(event));
+            bool cut = sim->copies_left == 0;
+            sim->copies_left = -1;
+            CHECK(keys_intact(ow, romcode, small, large));
+            CHECK(appended || cut);
+            if (!cut) {
+                break;
+            }
+        }
+
+        // Append with power on, and check the log still works after the last cut.
+        memcpy(sim->memory, snapshot, sizeof(snapshot));
+        CHECK(ds2431_log_mount(&log, ow, romcode));
+        sim->copies_left = DS2431_ROWS;
+        CHECK(ds2431_log_append(&log, DS2431_LOG_EVENT, event, sizeof(event)));
+        moved = moved || DS2431_ROWS - sim->copies_left > 1;
+        sim->copies_left = -1;
+        CHECK(same_as_mount(&log));
+    }
+    CHECK(moved);
+    CHECK(keys_intact(ow, romcode, small, large));
+}
+
+int main(void) {
+    ow_sim_bus bus;
+    ow_sim_bus_init(&bus);
+    ds2431_sim sim;
+    uint64_t romcode = make_romcode(DS2431_FAMILY, 1);
+    ds2431_sim_init(&sim, romcode);
+    ow_sim_attach(&bus, &sim.dev);
+    OW ow;
+    ow_sim_init(&ow, &bus);
+
+    test_wrap(&ow, &sim, &romcode);
+    test_compaction(&ow, &sim, &romcode);
+    test_bad_crc(&ow, &sim, &romcode);
+    test_power_loss(&ow, &sim, &romcode);
+
+    ow_sim_bus_free(&bus);
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
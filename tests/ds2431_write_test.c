@@ -0,0 +1,95 @@
+#include "ds2431_sim.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(condition) do {                                               \
+        if (!(condition)) {                                                 \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief Make a ROM code with a valid CRC.
+ */
+static uint64_t make_romcode(uint8_t family, uint8_t serial) {
+    uint8_t rom[8] = {family, serial, 1, 2, 3, 4, 5};
+    rom[7] = ow_crc_8(rom, 7);
+    uint64_t romcode = 0;
+    for (int i = 0; i < 8; i++) {
+        romcode |= (uint64_t)rom[i] << (8*i);
+    }
+    return romcode;
+}
+
+/**
+ * @brief The scratchpad is verified before every copy, and read again after a CRC failure.
+ */
+static void test_row_verify(OW *ow, ds2431_sim *sim, uint64_t *romcode) {
+    uint8_t row[DS2431_ROW_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8};
+    CHECK(ds2431_write_row(ow, romcode, 0x10, row, sizeof(row)));
+    CHECK(memcmp(&sim->memory[0x10], row, sizeof(row)) == 0);
+
+    // One corrupted read: the second read passes and the row is copied.
+    row[0] = 0x11;
+    sim->corrupt_reads = 1;
+    CHECK(ds2431_write_row(ow, romcode, 0x10, row, sizeof(row)));
+    CHECK(sim->corrupt_reads == 0);
+    CHECK(memcmp(&sim->memory[0x10], row, sizeof(row)) == 0);
+
+    // Every read corrupted: the copy is never sent.
+    uint8_t old[DS2431_ROW_SIZE];
+    memcpy(old, row, sizeof(row));
+    row[0] = 0x22;
+    sim->corrupt_reads = DS2431_READ_RETRY;
+    CHECK(!ds2431_write_row(ow, romcode, 0x10, row, sizeof(row)));
+    CHECK(sim->corrupt_reads == 0);
+    CHECK(memcmp(&sim->memory[0x10], old, sizeof(old)) == 0);
+}
+
+/**
+ * @brief A corrupted pre-read of ds2431_write neither skips a changed row nor merges wrong neighbour bytes.
+ */
+static void test_pre_read(OW *ow, ds2431_sim *sim, uint64_t *romcode) {
+    uint8_t row[DS2431_ROW_SIZE] = {0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37};
+    CHECK(ds2431_write(ow, romcode, 0x20, row, sizeof(row)));
+
+    // The first read shows the new value of the first byte, so a single read would skip the row.
+    uint8_t byte = 0x31;
+    sim->corrupt_memory_reads = 1;
+    CHECK(ds2431_write(ow, romcode, 0x20, &byte, 1));
+    CHECK(sim->memory[0x20] == 0x31);
+
+    // A partial write keeps the neighbouring bytes when one read is corrupted.
+    byte = 0x44;
+    sim->corrupt_memory_reads = 1;
+    CHECK(ds2431_write(ow, romcode, 0x23, &byte, 1));
+    uint8_t expected[DS2431_ROW_SIZE] = {0x31, 0x31, 0x32, 0x44, 0x34, 0x35, 0x36, 0x37};
+    CHECK(memcmp(&sim->memory[0x20], expected, sizeof(expected)) == 0);
+
+    // Reads that never agree: nothing is programmed.
+    byte = 0x55;
+    sim->corrupt_memory_reads = 0xFF;
+    CHECK(!ds2431_write(ow, romcode, 0x23, &byte, 1));
+    sim->corrupt_memory_reads = 0;
+    CHECK(memcmp(&sim->memory[0x20], expected, sizeof(expected)) == 0);
+}
+
+int main(void) {
+    ow_sim_bus bus;
+    ow_sim_bus_init(&bus);
+    ds2431_sim sim;
+    uint64_t romcode = make_romcode(DS2431_FAMILY, 1);
+    ds2431_sim_init(&sim, romcode);
+    ow_sim_attach(&bus, &sim.dev);
+    OW ow;
+    ow_sim_init(&ow, &bus);
+
+    test_row_verify(&ow, &sim, &romcode);
+    test_pre_read(&ow, &sim, &romcode);
+
+    ow_sim_bus_free(&bus);
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+#include "ds2431_sim.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(condition) do {                                               \
+        if (!(condition)) {                                                 \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief Make a ROM code with a valid CRC.
+ */
+static uint64_t make_romcode(uint8_t family, uint8_t serial) {
+    uint8_t rom[8] = {family, serial, 1, 2, 3, 4, 5};
+    rom[7] = ow_crc_8(rom, 7);
+    uint64_t romcode = 0;
+    for (int i = 0; i < 8; i++) {
+        romcode |= (uint64_t)rom[i] << (8*i);
+    }
+    return romcode;
+}
+
+/**
+ * @brief Find a ROM code in an array. Returns its index, or -1.
+ */
+static int find_romcode(const uint64_t *romcodes, int count, uint64_t romcode) {
+    for (int i = 0; i < count; i++) {
+        if (romcodes[i] == romcode) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief A pass that fails its CRC is retried from its branch point, without restarting the search.
+ */
+static void test_search_retry(void) {
+    enum {num_devices = 8};
+    ow_sim_bus bus;
+    ow_sim_bus_init(&bus);
+    ow_sim_device devices[num_devices];
+    for (int i = 0; i < num_devices; i++) {
+        ow_sim_device_init(&devices[i], make_romcode(0x01, (uint8_t)(0x11 * (i + 1))), NULL);
+        ow_sim_attach(&bus, &devices[i]);
+    }
+    OW ow;
+    ow_sim_init(&ow, &bus);
+    uint64_t romcodes[num_devices];
+    uint8_t status[num_devices];
+
+    uint64_t resets = bus.resets;
+    CHECK(ow_romsearch_status(&ow, romcodes, status, num_devices, OW_SEARCH_ROM) == num_devices);
+    CHECK(bus.resets - resets == num_devices);
+    for (int i = 0; i < num_devices; i++) {
+        CHECK(status[i] == OW_ROM_OK);
+    }
+
+    // One bad pass: only that pass is run again.
+    devices[5].corrupt_searches = 1;
+    resets = bus.resets;
+    CHECK(ow_romsearch_status(&ow, romcodes, status, num_devices, OW_SEARCH_ROM) == num_devices);
+    CHECK(bus.resets - resets == num_devices + 1);
+    for (int i = 0; i < num_devices; i++) {
+        int found = find_romcode(romcodes, num_devices, devices[i].romcode);
+        CHECK(found >= 0 && status[found] == (i == 5 ? OW_ROM_RETRIED : OW_ROM_OK));
+    }
+
+    // A pass that never passes is reported, and the search carries on with the other branches.
+    devices[2].corrupt_searches = OW_SEARCH_RETRY + 1;
+    resets = bus.resets;
+    CHECK(ow_romsearch_status(&ow, romcodes, status, num_devices, OW_SEARCH_ROM) == num_devices);
+    CHECK(bus.resets - resets == num_devices + OW_SEARCH_RETRY);
+    for (int i = 0; i < num_devices; i++) {
+        int found = find_romcode(romcodes, num_devices, devices[i].romcode ^ (i == 2 ? 1ull << 56 : 0));
+        CHECK(found >= 0 && status[found] == (i == 2 ? OW_ROM_CRC_ERROR : OW_ROM_OK));
+    }
+    devices[2].corrupt_searches = OW_SEARCH_RETRY + 1;
+    CHECK(ow_romsearch(&ow, romcodes, num_devices, OW_SEARCH_ROM) == num_devices - 1);
+    CHECK(find_romcode(romcodes, num_devices - 1, devices[2].romcode) < 0);
+    ow_sim_bus_free(&bus);
+}
+
+/**
+ * @brief A search of several buses at once finds what a search of each in turn finds.
+ */
+static void test_romsearch_multi(void) {
+    enum {num_buses = 3, max_devices = 20};
+    static const int counts[num_buses] = {0, 5, 17};
+    ow_sim_bus buses[num_buses];
+    OW ows[num_buses];
+    ow_sim_device devices[num_buses][max_devices];
+    for (int b = 0; b < num_buses; b++) {
+        ow_sim_bus_init(&buses[b]);
+        for (int i = 0; i < counts[b]; i++) {
+            ow_sim_device_init(&devices[b][i], make_romcode(0x10 + b, (uint8_t)(37 * i + b)), NULL);
+            ow_sim_attach(&buses[b], &devices[b][i]);
+        }
+        ow_sim_init(&ows[b], &buses[b]);
+    }
+    devices[2][9].corrupt_searches = 1;     // One retried pass on one bus.
+
+    for (int maxdevs = 0; maxdevs <= max_devices; maxdevs += 4) {
+        uint64_t found[num_buses][max_devices];
+        uint64_t *romcodes[num_buses] = {found[0], found[1], found[2]};
+        int num_found[num_buses];
+        ow_romsearch_multi(ows, num_buses, romcodes, maxdevs, OW_SEARCH_ROM, num_found);
+        for (int b = 0; b < num_buses; b++) {
+            uint64_t expected[max_devices];
+            int num_expected = ow_romsearch(&ows[b], expected, maxdevs, OW_SEARCH_ROM);
+            CHECK(num_found[b] == num_expected);
+            CHECK(memcmp(found[b], expected, num_expected * sizeof(expected[0])) == 0);
+        }
+    }
+    for (int b = 0; b < num_buses; b++) {
+        ow_sim_bus_free(&buses[b]);
+    }
+}
+
+/**
+ * @brief OW_RESUME re-selects the last device matched until another ROM command is sent.
+ */
+static void test_resume(void) {
+    ow_sim_bus bus;
+    ow_sim_bus_init(&bus);
+    ds2431_sim first, second;
+    ds2431_sim_init(&first, make_romcode(DS2431_FAMILY, 1));
+    ds2431_sim_init(&second, make_romcode(DS2431_FAMILY, 2));
+    memset(first.memory, 0xA5, DS2431_SIZE);
+    memset(second.memory, 0x5A, DS2431_SIZE);
+    ow_sim_attach(&bus, &first.dev);
+    ow_sim_attach(&bus, &second.dev);
+    OW ow;
+    ow_sim_init(&ow, &bus);
+    uint64_t a = first.dev.romcode;
+    uint64_t b = second.dev.romcode;
+    const uint64_t read_slots = 8 * (3 + DS2431_ROW_SIZE);     // READ MEMORY, TA1, TA2 and the data.
+    uint8_t buffer[DS2431_ROW_SIZE];
+
+    // MATCH ROM, then RESUME.
+    uint64_t slots = bus.slots;
+    CHECK(ds2431_read(&ow, &a, DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0xA5);
+    CHECK(bus.slots - slots == 8 * 9 + read_slots);
+    slots = bus.slots;
+    CHECK(ds2431_read(&ow, &a, DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0xA5);
+    CHECK(bus.slots - slots == 8 + read_slots);
+
+    // A ROM command sent directly ends resuming, on the device and in the driver.
+    ow_reset(&ow);
+    ow_send(&ow, OW_SKIP_ROM);
+    CHECK(!ow.resume);
+    slots = bus.slots;
+    CHECK(ds2431_read(&ow, &a, DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0xA5);
+    CHECK(bus.slots - slots == 8 * 9 + read_slots);
+
+    // So do a search, and matching another device.
+    CHECK(ow_verify(&ow, b));
+    CHECK(!ow.resume);
+    CHECK(ds2431_read(&ow, &a, DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0xA5);
+    CHECK(ds2431_read(&ow, &b, DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0x5A);
+    slots = bus.slots;
+    CHECK(ds2431_read(&ow, &a, DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0xA5);
+    CHECK(bus.slots - slots == 8 * 9 + read_slots);
+
+    // A device that does not support it is always matched.
+    uint64_t sensor = make_romcode(0x28, 3);
+    CHECK(!ow_family_resume(ow_family(&sensor)));
+    ow_sim_bus_free(&bus);
+}
+
+/**
+ * @brief A device added to a single-drop bus ends OW_SKIP_ROM selection within OW_SINGLE_DROP_CHECK selects.
+ */
+static void test_single_drop(void) {
+    ow_sim_bus bus;
+    ow_sim_bus_init(&bus);
+    ds2431_sim first, second;
+    ds2431_sim_init(&first, make_romcode(DS2431_FAMILY, 1));
+    ds2431_sim_init(&second, make_romcode(DS2431_FAMILY, 2));
+    memset(first.memory, 0xA5, DS2431_SIZE);
+    memset(second.memory, 0x5A, DS2431_SIZE);
+    ow_sim_attach(&bus, &first.dev);
+    OW ow;
+    ow_sim_init(&ow, &bus);
+
+    uint64_t romcodes[2];
+    CHECK(ow_discover(&ow, romcodes, 2) == 1);
+    CHECK(ow.single_drop);
+    uint8_t buffer[DS2431_ROW_SIZE];
+    uint64_t slots = bus.slots;
+    CHECK(ds2431_read(&ow, &romcodes[0], DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0xA5);
+    CHECK(bus.slots - slots == 8 * (1 + 3 + DS2431_ROW_SIZE));     // SKIP ROM, no ROM code.
+
+    // Hot-plug a second device: the periodic check notices it and selection falls back to OW_MATCH_ROM.
+    ow_sim_attach(&bus, &second.dev);
+    for (int i = 0; i < OW_SINGLE_DROP_CHECK && ow.single_drop; i++) {
+        ds2431_read(&ow, &romcodes[0], DS2431_START, buffer, sizeof(buffer));
+    }
+    CHECK(!ow.single_drop);
+    CHECK(ds2431_read(&ow, &romcodes[0], DS2431_START, buffer, sizeof(buffer)) && buffer[0] == 0xA5);
+
+    // Rediscovery finds both, and an explicit check after a change of population.
+    CHECK(ow_discover(&ow, romcodes, 2) == 2);
+    CHECK(!ow.single_drop);
+    ow_sim_detach(&bus, &second.dev);
+    CHECK(ow_discover(&ow, romcodes, 2) == 1);
+    CHECK(ow_single_drop_check(&ow));
+    ow_sim_attach(&bus, &second.dev);
+    CHECK(!ow_single_drop_check(&ow));
+
+    // A reset without presence also ends it.
+    ow_sim_detach(&bus, &second.dev);
+    CHECK(ow_discover(&ow, romcodes, 2) == 1);
+    ow_sim_detach(&bus, &first.dev);
+    CHECK(!ow_reset(&ow));
+    CHECK(!ow.single_drop);
+    ow_sim_bus_free(&bus);
+}
+
+int main(void) {
+    test_search_retry();
+    test_romsearch_multi();
+    test_resume();
+    test_single_drop();
+
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/**
+ * Convert an ow_trace dump into a value change dump (VCD) for GTKWave or sigrok (PulseView: Import, VCD).
+ *
+ * The bus waveform is rebuilt from the events with the slot timing of onewire.pio, together with the event type and
+ * byte value as vectors.
+ *
+ * Usage: ow_trace_vcd dump.bin [trace.vcd]
+ */
+#include "ow_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define VCD_RESET_LOW_US        480     /**< Reset pulse. */
+#define VCD_PRESENCE_WAIT_US    30      /**< Presence pulse delay after the reset pulse. */
+#define VCD_PRESENCE_US         120     /**< Presence pulse. */
+#define VCD_WRITE_0_US          60      /**< Low time of a write 0 slot. */
+#define VCD_READ_0_US           30      /**< Low time of a read slot answered with 0. */
+#define VCD_RELEASE_US          6       /**< Low time of a write 1 or read slot answered with 1. */
+
+/**
+ * @brief VCD writer, dropping changes that would go back in time when events overlap.
+ */
+typedef struct {
+    FILE *out;
+    uint64_t now;
+    bool started;
+    int line;
+} vcd_writer;
+
+static void vcd_time(vcd_writer *w, uint64_t t) {
+    if (t > w->now || !w->started) {
+        fprintf(w->out, "#%llu\n", (unsigned long long)t);
+        w->now = t;
+        w->started = true;
+    }
+}
+
+static void vcd_line(vcd_writer *w, uint64_t t, int level) {
+    if (t < w->now || level == w->line) {
+        return;
+    }
+    vcd_time(w, t);
+    fprintf(w->out, "%d!\n", level);
+    w->line = level;
+}
+
+static void vcd_vector(vcd_writer *w, uint64_t t, uint value, char id) {
+    if (t < w->now) {
+        t = w->now;
+    }
+    vcd_time(w, t);
+    fputc('b', w->out);
+    for (int i = 7; i >= 0; i--) {
+        fputc('0' + ((value >> i) & 1), w->out);
+    }
+    fprintf(w->out, " %c\n", id);
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s dump.bin [trace.vcd]\n", argv[0]);
+        return 2;
+    }
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    uint8_t header[OW_TRACE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), in) != sizeof(header) || get32(&header[0]) != OW_TRACE_MAGIC ||
+        get32(&header[4]) != OW_TRACE_VERSION) {
+        fprintf(stderr, "%s: not an ow_trace dump\n", argv[1]);
+        return 1;
+    }
+    uint32_t count = get32(&header[8]);
+    vcd_writer w = {argc > 2 ? fopen(argv[2], "w") : stdout, 0, false, -1};
+    if (w.out == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fprintf(w.out, "$comment ow_trace: %u events, %u dropped $end\n", count, get32(&header[12]));
+    fprintf(w.out, "$timescale 1us $end\n$scope module onewire $end\n");
+    fprintf(w.out, "$var wire 1 ! dq $end\n$var wire 8 \" type $end\n$var wire 8 # data $end\n");
+    fprintf(w.out, "$upscope $end\n$enddefinitions $end\n");
+    vcd_line(&w, 0, 1);
+
+    // Times are 32-bit and wrap, so accumulate the differences.
+    uint64_t t = 0;
+    uint32_t last = 0;
+    for (uint32_t n = 0; n < count; n++) {
+        uint8_t event[OW_TRACE_EVENT_SIZE];
+        if (fread(event, 1, sizeof(event), in) != sizeof(event)) {
+            fprintf(stderr, "%s: truncated after %u events\n", argv[1], n);
+            break;
+        }
+        uint32_t time_us = get32(&event[0]);
+        uint type = event[4];
+        uint data = event[5];
+        t += n == 0 ? 0 : (uint32_t)(time_us - last);
+        last = time_us;
+
+        vcd_vector(&w, t, type, '"');
+        vcd_vector(&w, t, data, '#');
+        if (type == OW_TRACE_RESET) {
+            vcd_line(&w, t, 0);
+            vcd_line(&w, t + VCD_RESET_LOW_US, 1);
+            if (data) {
+                vcd_line(&w, t + VCD_RESET_LOW_US + VCD_PRESENCE_WAIT_US, 0);
+                vcd_line(&w, t + VCD_RESET_LOW_US + VCD_PRESENCE_WAIT_US + VCD_PRESENCE_US, 1);
+            }
+            continue;
+        }
+        for (uint i = 0; i < 8; i++) {
+            uint64_t slot = t + i * OW_SLOT_US;
+            uint bit = (data >> i) & 1;
+            uint low = bit ? VCD_RELEASE_US : (type == OW_TRACE_READ ? VCD_READ_0_US : VCD_WRITE_0_US);
+            vcd_line(&w, slot, 0);
+            vcd_line(&w, slot + low, 1);
+        }
+    }
+    fclose(in);
+    if (w.out != stdout) {
+        fclose(w.out);
+    }
+    return 0;
+}